@@ -0,0 +1,617 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Benchmark harness for the deepspeech element.
+ *
+ * Feeds a corpus of WAV files through appsrc ! deepspeech ! fakesink and
+ * prints one line per configuration of a sweep over modes, stream counts,
+ * buffer sizes, beam widths and feed modes:
+ *
+ *   mode      "fast" pushes audio as quickly as the element takes it,
+ *             "live" paces it at real time from a live appsrc
+ *   rtf       wall clock time over the total amount of audio, so with
+ *             several streams this is the aggregate real-time factor
+ *   p50, p99  time from the last buffer of an utterance being pushed to
+ *             its final result, in milliseconds
+ *   rss       peak resident set size in KiB, model and corpus included
+ *   cpu       user and system CPU time in seconds, model loading excluded
+ *
+ * Every configuration runs in a child process of its own, so peak RSS and
+ * the shared model don't carry over from one to the next. The streams of a
+ * configuration share one model, like elements in one application do.
+ *
+ * The corpus files must be 16 bit PCM; files with a different rate or
+ * channel count from the first one are skipped. Each stream transcribes
+ * the whole corpus, played back to back.
+ *
+ *   deepspeech-bench --model=deepspeech.pbmm --streams=1,4 --modes=fast \
+ *       --beam-width=500,100 --feed-mode=segment,incremental corpus/
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+
+typedef struct
+{
+  gint rate;
+  gint channels;
+  gint16 *data;
+  gsize n_frames;
+} BenchCorpus;
+
+typedef struct
+{
+  gboolean live;
+  guint streams;
+  guint buffer_ms;
+  guint beam_width;
+  const gchar *feed_mode;
+} BenchConfig;
+
+typedef struct _BenchRun BenchRun;
+
+typedef struct
+{
+  BenchRun *run;
+  GstElement *pipeline;
+  GstElement *appsrc;
+  GThread *feeder;
+  /* when each buffer was pushed, in monotonic microseconds; written before
+   * the push, so before any result covering the buffer is posted */
+  gint64 *push_times;
+} BenchStream;
+
+struct _BenchRun
+{
+  const BenchConfig *config;
+  const BenchCorpus *corpus;
+  gsize frames_per_buffer;
+  guint n_buffers;
+  BenchStream *streams;
+  GMutex lock;
+  GCond cond;
+  guint running;
+  gboolean failed;
+  GArray *latencies;
+};
+
+static gchar *model_path;
+static gchar *scorer_path;
+static gchar *modes_list = (gchar *) "fast,live";
+static gchar *streams_list = (gchar *) "1";
+static gchar *buffer_list = (gchar *) "20";
+static gchar *beam_list = (gchar *) "500";
+static gchar *feed_list = (gchar *) "segment";
+static gchar **extra_properties;
+
+static GOptionEntry entries[] = {
+  {"model", 'm', 0, G_OPTION_ARG_FILENAME, &model_path, "Speech model", "FILE"},
+  {"scorer", 's', 0, G_OPTION_ARG_FILENAME, &scorer_path, "Scorer", "FILE"},
+  {"modes", 0, 0, G_OPTION_ARG_STRING, &modes_list, "Modes to run (fast,live)", "LIST"},
+  {"streams", 0, 0, G_OPTION_ARG_STRING, &streams_list, "Numbers of concurrent streams", "LIST"},
+  {"buffer-ms", 0, 0, G_OPTION_ARG_STRING, &buffer_list, "Buffer durations in milliseconds", "LIST"},
+  {"beam-width", 0, 0, G_OPTION_ARG_STRING, &beam_list, "Beam widths", "LIST"},
+  {"feed-mode", 0, 0, G_OPTION_ARG_STRING, &feed_list, "Feed modes (segment,incremental)", "LIST"},
+  {"set", 0, 0, G_OPTION_ARG_STRING_ARRAY, &extra_properties, "Set another deepspeech property", "PROPERTY=VALUE"},
+  {NULL}
+};
+
+static guint16
+read_le16 (const guint8 * p)
+{
+  return (guint16) (p[0] | (p[1] << 8));
+}
+
+static guint32
+read_le32 (const guint8 * p)
+{
+  return (guint32) p[0] | ((guint32) p[1] << 8) | ((guint32) p[2] << 16) |
+      ((guint32) p[3] << 24);
+}
+
+/* Appends the samples of a 16 bit PCM WAV file to the corpus, whose format
+ * the first file sets. */
+static gboolean
+bench_corpus_add (BenchCorpus * corpus, const gchar * path)
+{
+  gchar *contents;
+  gsize length, pos = 12;
+  const guint8 *data = NULL, *p;
+  guint32 data_size = 0;
+  gint rate = 0, channels = 0, bits = 0;
+  gsize n_frames;
+
+  if (!g_file_get_contents (path, &contents, &length, NULL)) {
+    g_printerr ("Could not read %s\n", path);
+    return FALSE;
+  }
+  p = (const guint8 *) contents;
+  if (length < 12 || memcmp (p, "RIFF", 4) != 0 || memcmp (p + 8, "WAVE", 4) != 0) {
+    g_printerr ("%s is not a WAV file\n", path);
+    g_free (contents);
+    return FALSE;
+  }
+
+  while (pos + 8 <= length) {
+    guint32 size = read_le32 (p + pos + 4);
+
+    if (memcmp (p + pos, "fmt ", 4) == 0 && size >= 16 && pos + 24 <= length) {
+      channels = read_le16 (p + pos + 10);
+      rate = (gint) read_le32 (p + pos + 12);
+      bits = read_le16 (p + pos + 22);
+    } else if (memcmp (p + pos, "data", 4) == 0) {
+      data = p + pos + 8;
+      data_size = (guint32) MIN ((gsize) size, length - pos - 8);
+      break;
+    }
+    pos += 8 + size + (size & 1);
+  }
+
+  if (data == NULL || bits != 16 || channels < 1 || rate <= 0) {
+    g_printerr ("Skipping %s, which isn't 16 bit PCM\n", path);
+    g_free (contents);
+    return FALSE;
+  }
+  if (corpus->rate == 0) {
+    corpus->rate = rate;
+    corpus->channels = channels;
+  } else if (rate != corpus->rate || channels != corpus->channels) {
+    g_printerr ("Skipping %s, which is %d Hz with %d channels instead of "
+        "%d Hz with %d\n", path, rate, channels, corpus->rate, corpus->channels);
+    g_free (contents);
+    return FALSE;
+  }
+
+  n_frames = data_size / (channels * sizeof (gint16));
+  corpus->data = g_renew (gint16, corpus->data,
+      (corpus->n_frames + n_frames) * channels);
+  memcpy (corpus->data + corpus->n_frames * channels, data,
+      n_frames * channels * sizeof (gint16));
+  corpus->n_frames += n_frames;
+  g_free (contents);
+  return TRUE;
+}
+
+static gint
+compare_strings (gconstpointer a, gconstpointer b)
+{
+  return strcmp (*(const gchar * const *) a, *(const gchar * const *) b);
+}
+
+/* Adds a file, or every .wav file in a directory in name order. */
+static void
+bench_corpus_add_path (BenchCorpus * corpus, const gchar * path)
+{
+  GPtrArray *files;
+  GDir *dir;
+  const gchar *name;
+  guint i;
+
+  if (!g_file_test (path, G_FILE_TEST_IS_DIR)) {
+    bench_corpus_add (corpus, path);
+    return;
+  }
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL) {
+    g_printerr ("Could not open %s\n", path);
+    return;
+  }
+  files = g_ptr_array_new_with_free_func (g_free);
+  while ((name = g_dir_read_name (dir))) {
+    if (g_str_has_suffix (name, ".wav") || g_str_has_suffix (name, ".WAV"))
+      g_ptr_array_add (files, g_build_filename (path, name, NULL));
+  }
+  g_dir_close (dir);
+
+  g_ptr_array_sort (files, compare_strings);
+  for (i = 0; i < files->len; i++)
+    bench_corpus_add (corpus, (const gchar *) g_ptr_array_index (files, i));
+  g_ptr_array_unref (files);
+}
+
+static void
+bench_run_stream_done (BenchRun * run, gboolean failed)
+{
+  g_mutex_lock (&run->lock);
+  run->running--;
+  run->failed |= failed;
+  g_cond_signal (&run->cond);
+  g_mutex_unlock (&run->lock);
+}
+
+/* Runs on whichever thread posts, so that the latency isn't measured
+ * through a main loop. */
+static GstBusSyncReply
+bench_bus_sync (GstBus * bus, GstMessage * message, gpointer user_data)
+{
+  BenchStream *stream = (BenchStream *) user_data;
+  BenchRun *run = stream->run;
+  const GstStructure *s;
+
+  switch (GST_MESSAGE_TYPE (message)) {
+    case GST_MESSAGE_ELEMENT:
+    {
+      GstClockTime timestamp, duration, end;
+      gboolean intermediate;
+      guint64 index;
+      gdouble latency;
+
+      s = gst_message_get_structure (message);
+      if (!gst_structure_has_name (s, "deepspeech") ||
+          !gst_structure_get_boolean (s, "intermediate", &intermediate) ||
+          intermediate ||
+          !gst_structure_get_uint64 (s, "timestamp", &timestamp) ||
+          !gst_structure_get_uint64 (s, "duration", &duration) ||
+          !GST_CLOCK_TIME_IS_VALID (timestamp))
+        break;
+
+      /* the buffer holding the utterance's last sample */
+      end = timestamp + (GST_CLOCK_TIME_IS_VALID (duration) ? duration : 0);
+      index = gst_util_uint64_scale (end, run->corpus->rate,
+          GST_SECOND * run->frames_per_buffer);
+      index = MIN (index, (guint64) run->n_buffers - 1);
+      latency = (g_get_monotonic_time () - stream->push_times[index]) / 1000.0;
+
+      g_mutex_lock (&run->lock);
+      g_array_append_val (run->latencies, latency);
+      g_mutex_unlock (&run->lock);
+      break;
+    }
+    case GST_MESSAGE_EOS:
+      bench_run_stream_done (run, FALSE);
+      break;
+    case GST_MESSAGE_ERROR:
+    {
+      GError *error;
+
+      gst_message_parse_error (message, &error, NULL);
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      bench_run_stream_done (run, TRUE);
+      break;
+    }
+    default:
+      break;
+  }
+
+  gst_message_unref (message);
+  return GST_BUS_DROP;
+}
+
+/* Pushes the corpus without copying it, paced at real time in live
+ * mode. */
+static gpointer
+bench_feeder (gpointer user_data)
+{
+  BenchStream *stream = (BenchStream *) user_data;
+  BenchRun *run = stream->run;
+  const BenchCorpus *corpus = run->corpus;
+  gsize frame_size = corpus->channels * sizeof (gint16);
+  gint64 start = g_get_monotonic_time ();
+  guint i;
+
+  for (i = 0; i < run->n_buffers; i++) {
+    gsize offset = i * run->frames_per_buffer;
+    gsize n_frames = MIN (run->frames_per_buffer, corpus->n_frames - offset);
+    GstBuffer *buf;
+
+    if (run->config->live) {
+      gint64 due = start + (gint64) gst_util_uint64_scale (offset, G_USEC_PER_SEC,
+          corpus->rate);
+      gint64 now = g_get_monotonic_time ();
+
+      if (due > now)
+        g_usleep (due - now);
+    }
+
+    buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        corpus->data + offset * corpus->channels, n_frames * frame_size, 0,
+        n_frames * frame_size, NULL, NULL);
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale (offset, GST_SECOND, corpus->rate);
+    GST_BUFFER_DURATION (buf) = gst_util_uint64_scale (n_frames, GST_SECOND,
+        corpus->rate);
+
+    stream->push_times[i] = g_get_monotonic_time ();
+    if (gst_app_src_push_buffer (GST_APP_SRC (stream->appsrc), buf) != GST_FLOW_OK)
+      break;
+  }
+  gst_app_src_end_of_stream (GST_APP_SRC (stream->appsrc));
+
+  return NULL;
+}
+
+static gboolean
+bench_stream_init (BenchStream * stream, BenchRun * run)
+{
+  const BenchConfig *config = run->config;
+  const BenchCorpus *corpus = run->corpus;
+  GstElement *deepspeech;
+  GstCaps *caps;
+  GstBus *bus;
+  GError *error = NULL;
+  guint i;
+
+  stream->run = run;
+  stream->push_times = g_new0 (gint64, run->n_buffers);
+  stream->pipeline = gst_parse_launch ("appsrc name=src ! deepspeech name=ds ! "
+      "fakesink sync=false", &error);
+  if (stream->pipeline == NULL) {
+    g_printerr ("Could not create the pipeline: %s\n", error->message);
+    g_error_free (error);
+    return FALSE;
+  }
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, "S16LE",
+      "layout", G_TYPE_STRING, "interleaved",
+      "rate", G_TYPE_INT, corpus->rate,
+      "channels", G_TYPE_INT, corpus->channels, NULL);
+  stream->appsrc = gst_bin_get_by_name (GST_BIN (stream->pipeline), "src");
+  g_object_set (stream->appsrc, "caps", caps, "format", GST_FORMAT_TIME,
+      "is-live", config->live, "block", TRUE,
+      "max-bytes", (guint64) corpus->rate * corpus->channels * sizeof (gint16),
+      NULL);
+  gst_caps_unref (caps);
+
+  deepspeech = gst_bin_get_by_name (GST_BIN (stream->pipeline), "ds");
+  g_object_set (deepspeech, "speech-model", model_path, "beam-width",
+      (gint) config->beam_width, NULL);
+  if (scorer_path)
+    g_object_set (deepspeech, "scorer", scorer_path, NULL);
+  gst_util_set_object_arg (G_OBJECT (deepspeech), "feed-mode", config->feed_mode);
+  for (i = 0; extra_properties && extra_properties[i]; i++) {
+    gchar **pair = g_strsplit (extra_properties[i], "=", 2);
+
+    if (pair[0] && pair[1])
+      gst_util_set_object_arg (G_OBJECT (deepspeech), pair[0], pair[1]);
+    g_strfreev (pair);
+  }
+  gst_object_unref (deepspeech);
+
+  bus = gst_element_get_bus (stream->pipeline);
+  gst_bus_set_sync_handler (bus, bench_bus_sync, stream, NULL);
+  gst_object_unref (bus);
+
+  return TRUE;
+}
+
+static gdouble
+percentile (GArray * values, gdouble q)
+{
+  gsize index;
+
+  if (values->len == 0)
+    return NAN;
+  index = (gsize) ceil (q * values->len);
+  return g_array_index (values, gdouble, index > 0 ? index - 1 : 0);
+}
+
+static gint
+compare_doubles (gconstpointer a, gconstpointer b)
+{
+  gdouble x = *(const gdouble *) a, y = *(const gdouble *) b;
+
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static gdouble
+cpu_seconds (const struct rusage *usage)
+{
+  return usage->ru_utime.tv_sec + usage->ru_stime.tv_sec +
+      (usage->ru_utime.tv_usec + usage->ru_stime.tv_usec) / 1e6;
+}
+
+/* Runs one configuration and prints its line. Called in a fresh child
+ * process. */
+static gboolean
+bench_run (const BenchConfig * config, const BenchCorpus * corpus)
+{
+  BenchRun run = { 0, };
+  struct rusage before, after;
+  gint64 start, elapsed;
+  gdouble audio, rtf;
+  guint i;
+  gboolean ok = TRUE;
+
+  run.config = config;
+  run.corpus = corpus;
+  run.frames_per_buffer = MAX (1, (gsize) corpus->rate * config->buffer_ms / 1000);
+  run.n_buffers = (corpus->n_frames + run.frames_per_buffer - 1) /
+      run.frames_per_buffer;
+  run.streams = g_new0 (BenchStream, config->streams);
+  run.latencies = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  g_mutex_init (&run.lock);
+  g_cond_init (&run.cond);
+
+  for (i = 0; ok && i < config->streams; i++)
+    ok = bench_stream_init (&run.streams[i], &run);
+
+  /* the model is loaded, once, before the clock starts */
+  for (i = 0; ok && i < config->streams; i++)
+    ok = gst_element_set_state (run.streams[i].pipeline, GST_STATE_READY) !=
+        GST_STATE_CHANGE_FAILURE;
+  if (!ok) {
+    g_printerr ("Could not start the pipelines\n");
+    return FALSE;
+  }
+
+  getrusage (RUSAGE_SELF, &before);
+  start = g_get_monotonic_time ();
+  run.running = config->streams;
+  for (i = 0; i < config->streams; i++) {
+    gst_element_set_state (run.streams[i].pipeline, GST_STATE_PLAYING);
+    run.streams[i].feeder = g_thread_new ("bench-feeder", bench_feeder,
+        &run.streams[i]);
+  }
+
+  g_mutex_lock (&run.lock);
+  while (run.running > 0)
+    g_cond_wait (&run.cond, &run.lock);
+  g_mutex_unlock (&run.lock);
+  elapsed = g_get_monotonic_time () - start;
+  getrusage (RUSAGE_SELF, &after);
+
+  for (i = 0; i < config->streams; i++) {
+    g_thread_join (run.streams[i].feeder);
+    gst_element_set_state (run.streams[i].pipeline, GST_STATE_NULL);
+  }
+
+  audio = (gdouble) corpus->n_frames / corpus->rate * config->streams;
+  rtf = elapsed / 1e6 / audio;
+  g_array_sort (run.latencies, compare_doubles);
+  printf ("%s\t%u\t%u\t%u\t%s\t%.3f\t%.0f\t%.0f\t%ld\t%.2f%s\n",
+      config->live ? "live" : "fast", config->streams, config->buffer_ms,
+      config->beam_width, config->feed_mode, rtf,
+      percentile (run.latencies, 0.5), percentile (run.latencies, 0.99),
+      after.ru_maxrss, cpu_seconds (&after) - cpu_seconds (&before),
+      run.failed ? "\tfailed" : "");
+  fflush (stdout);
+
+  return !run.failed;
+}
+
+static GArray *
+parse_uint_list (const gchar * list)
+{
+  GArray *values = g_array_new (FALSE, FALSE, sizeof (guint));
+  gchar **items = g_strsplit (list, ",", -1);
+  guint i;
+
+  for (i = 0; items[i]; i++) {
+    guint value = (guint) g_ascii_strtoull (items[i], NULL, 10);
+
+    if (value > 0)
+      g_array_append_val (values, value);
+  }
+  g_strfreev (items);
+  return values;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  BenchCorpus corpus = { 0, };
+  GArray *streams, *buffers, *beams;
+  gchar **modes, **feed_modes;
+  guint m, s, b, w, f;
+  gint i, failures = 0;
+
+  context = g_option_context_new ("CORPUS... - benchmark the deepspeech element");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (model_path == NULL || argc < 2) {
+    g_printerr ("Usage: %s --model=FILE [OPTION...] CORPUS...\n", argv[0]);
+    return 1;
+  }
+
+  for (i = 1; i < argc; i++)
+    bench_corpus_add_path (&corpus, argv[i]);
+  if (corpus.n_frames == 0) {
+    g_printerr ("No audio in the corpus\n");
+    return 1;
+  }
+
+  modes = g_strsplit (modes_list, ",", -1);
+  streams = parse_uint_list (streams_list);
+  buffers = parse_uint_list (buffer_list);
+  beams = parse_uint_list (beam_list);
+  feed_modes = g_strsplit (feed_list, ",", -1);
+
+  printf ("# %.1f s of audio at %d Hz, %d channels\n",
+      (gdouble) corpus.n_frames / corpus.rate, corpus.rate, corpus.channels);
+  printf ("mode\tstreams\tbuffer-ms\tbeam-width\tfeed-mode\trtf\tp50-ms\t"
+      "p99-ms\trss-kb\tcpu-s\n");
+  fflush (stdout);
+
+  for (m = 0; modes[m]; m++)
+    for (s = 0; s < streams->len; s++)
+      for (b = 0; b < buffers->len; b++)
+        for (w = 0; w < beams->len; w++)
+          for (f = 0; feed_modes[f]; f++) {
+            BenchConfig config;
+            pid_t pid;
+            gint status;
+
+            config.live = g_strcmp0 (modes[m], "live") == 0;
+            config.streams = g_array_index (streams, guint, s);
+            config.buffer_ms = g_array_index (buffers, guint, b);
+            config.beam_width = g_array_index (beams, guint, w);
+            config.feed_mode = feed_modes[f];
+
+            /* GStreamer is only initialized in the children, which start
+             * from the same single-threaded state every time */
+            pid = fork ();
+            if (pid == 0) {
+              gst_init (NULL, NULL);
+              _exit (bench_run (&config, &corpus) ? 0 : 1);
+            }
+            if (pid < 0 || waitpid (pid, &status, 0) < 0 ||
+                !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+              failures++;
+          }
+
+  g_strfreev (modes);
+  g_strfreev (feed_modes);
+  g_array_unref (streams);
+  g_array_unref (buffers);
+  g_array_unref (beams);
+  g_free (corpus.data);
+
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,331 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Microbenchmarks of the per-buffer work on the streaming thread, which has
+ * to stay small next to the duration of a buffer:
+ *
+ *   energy    the sum of squares the silence detector runs on every buffer,
+ *             with the scalar loop and the vector kernel picked for this CPU
+ *   preroll   writing into the pre-roll ring while there is no speech
+ *   segment   appending to the audio ring of the current segment and
+ *             releasing it once consumed
+ *   handoff   passing a buffer's worth of audio to a worker thread through
+ *             the pending queue: copied into a fresh allocation, copied into
+ *             the shared ring as the element does, or not copied at all
+ *
+ * Each is timed at buffer sizes from 80 samples (5 ms at 16 kHz) up to
+ * 16000 (one second) and reported per buffer and per sample.
+ *
+ *   deepspeech-microbench [--sizes=80,160,...] [--time-ms=200]
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gst/base/gstqueuearray.h>
+
+#include "gstdeepspeechenergy.h"
+#include "gstdeepspeechring.h"
+
+/* rings hold this many buffers, like the element's hold several segments */
+#define RING_BUFFERS 64
+/* buffers queued for the worker before the producer waits */
+#define HANDOFF_DEPTH 8
+
+typedef enum
+{
+  HANDOFF_COPY,
+  HANDOFF_RING,
+  HANDOFF_ZERO_COPY
+} HandoffVariant;
+
+typedef struct
+{
+  guint64 offset;
+  gsize n_samples;
+  /* the audio itself if it was copied, or borrowed in zero-copy mode */
+  const gint16 *samples;
+  gboolean owned;
+} MicroJob;
+
+typedef struct
+{
+  HandoffVariant variant;
+  GMutex lock;
+  GCond cond;
+  GstQueueArray *pending;
+  GstDeepSpeechRing ring;
+  gboolean stop;
+  guint64 checksum;
+} Handoff;
+
+static gchar *sizes_list = (gchar *) "80,160,320,800,1600,3200,8000,16000";
+static gint time_ms = 200;
+
+static GOptionEntry entries[] = {
+  {"sizes", 0, 0, G_OPTION_ARG_STRING, &sizes_list, "Buffer sizes in samples", "LIST"},
+  {"time-ms", 0, 0, G_OPTION_ARG_INT, &time_ms, "How long to run each benchmark", "MS"},
+  {NULL}
+};
+
+/* results end up here, so that the compiler can't drop the work */
+guint64 microbench_sink;
+
+static void
+report (const char * name, const char * variant, gsize n_samples,
+    guint64 iterations, gint64 elapsed)
+{
+  gdouble ns = elapsed * 1000.0 / iterations;
+
+  printf ("%s\t%s\t%" G_GSIZE_FORMAT "\t%.1f\t%.3f\t%.0f\n", name, variant,
+      n_samples, ns, ns / n_samples, n_samples * sizeof (gint16) * 1000.0 / ns);
+}
+
+/* Runs body over and over for about time_ms, checking the clock only every
+ * batch iterations so that reading it doesn't dominate. */
+#define TIMED_LOOP(iterations, elapsed, body)                                 \
+  G_STMT_START {                                                              \
+    gint64 _start = g_get_monotonic_time ();                                  \
+    gint64 _deadline = _start + (gint64) time_ms * 1000;                      \
+    guint _i;                                                                 \
+    (iterations) = 0;                                                         \
+    do {                                                                      \
+      for (_i = 0; _i < 64; _i++) {                                           \
+        body;                                                                 \
+      }                                                                       \
+      (iterations) += 64;                                                     \
+    } while (((elapsed) = g_get_monotonic_time ()) < _deadline);              \
+    (elapsed) -= _start;                                                      \
+  } G_STMT_END
+
+static void
+bench_energy (const gint16 * samples, gsize n_samples)
+{
+  guint64 iterations, sum = 0;
+  gint64 elapsed;
+
+  TIMED_LOOP (iterations, elapsed,
+      sum += gst_deepspeech_sum_squares_scalar (samples, n_samples));
+  microbench_sink += sum;
+  report ("energy", "scalar", n_samples, iterations, elapsed);
+
+  TIMED_LOOP (iterations, elapsed,
+      sum += gst_deepspeech_sum_squares (samples, n_samples));
+  microbench_sink += sum;
+  report ("energy", "simd", n_samples, iterations, elapsed);
+}
+
+static void
+bench_accumulate (const gint16 * samples, gsize n_samples)
+{
+  GstDeepSpeechRing ring = { 0, };
+  guint64 iterations;
+  gint64 elapsed;
+
+  gst_deepspeech_ring_init (&ring, n_samples * RING_BUFFERS);
+  TIMED_LOOP (iterations, elapsed,
+      gst_deepspeech_ring_write (&ring, samples, n_samples));
+  microbench_sink += ring.end;
+  report ("preroll", "ring", n_samples, iterations, elapsed);
+
+  /* a segment every RING_BUFFERS / 2 buffers, consumed as soon as it ends */
+  gst_deepspeech_ring_clear (&ring);
+  TIMED_LOOP (iterations, elapsed, {
+        gst_deepspeech_ring_append (&ring, samples, n_samples);
+        if (ring.length >= n_samples * (RING_BUFFERS / 2))
+          gst_deepspeech_ring_release (&ring, ring.end);
+      });
+  microbench_sink += ring.end;
+  report ("segment", "ring", n_samples, iterations, elapsed);
+
+  gst_deepspeech_ring_free (&ring);
+}
+
+static gpointer
+handoff_worker (gpointer user_data)
+{
+  Handoff *handoff = (Handoff *) user_data;
+  MicroJob *job;
+
+  g_mutex_lock (&handoff->lock);
+  for (;;) {
+    while (!handoff->stop && gst_queue_array_is_empty (handoff->pending))
+      g_cond_wait (&handoff->cond, &handoff->lock);
+    if (gst_queue_array_is_empty (handoff->pending))
+      break;
+
+    job = (MicroJob *) gst_queue_array_pop_head_struct (handoff->pending);
+    if (handoff->variant == HANDOFF_RING) {
+      const gint16 *first, *second;
+      gsize first_len, second_len;
+
+      gst_deepspeech_ring_peek_range (&handoff->ring, job->offset,
+          job->n_samples, &first, &first_len, &second, &second_len);
+      handoff->checksum += first[0];
+      gst_deepspeech_ring_release (&handoff->ring, job->offset + job->n_samples);
+    } else {
+      handoff->checksum += job->samples[0];
+      if (job->owned)
+        g_free ((gpointer) job->samples);
+    }
+    g_cond_signal (&handoff->cond);
+  }
+  g_mutex_unlock (&handoff->lock);
+
+  return NULL;
+}
+
+/* One buffer from the streaming thread's side: wait for room, queue it and
+ * wake the worker, like gst_deepspeech_queue_job() and
+ * gst_deepspeech_write_audio() do. */
+static void
+handoff_push (Handoff * handoff, const gint16 * samples, gsize n_samples)
+{
+  MicroJob job;
+
+  job.n_samples = n_samples;
+  job.samples = samples;
+  job.owned = FALSE;
+  if (handoff->variant == HANDOFF_COPY) {
+    job.samples = (const gint16 *) g_memdup (samples, n_samples * sizeof (gint16));
+    job.owned = TRUE;
+  }
+
+  g_mutex_lock (&handoff->lock);
+  while (gst_queue_array_get_length (handoff->pending) >= HANDOFF_DEPTH ||
+      (handoff->variant == HANDOFF_RING &&
+          gst_deepspeech_ring_space (&handoff->ring) < n_samples))
+    g_cond_wait (&handoff->cond, &handoff->lock);
+
+  job.offset = handoff->ring.end;
+  if (handoff->variant == HANDOFF_RING)
+    gst_deepspeech_ring_append (&handoff->ring, samples, n_samples);
+  gst_queue_array_push_tail_struct (handoff->pending, &job);
+  g_cond_signal (&handoff->cond);
+  g_mutex_unlock (&handoff->lock);
+}
+
+static void
+bench_handoff (const gint16 * samples, gsize n_samples, HandoffVariant variant)
+{
+  static const char *names[] = { "copy", "ring", "zero-copy" };
+  Handoff handoff;
+  GThread *worker;
+  guint64 iterations;
+  gint64 elapsed;
+
+  memset (&handoff, 0, sizeof (handoff));
+  handoff.variant = variant;
+  g_mutex_init (&handoff.lock);
+  g_cond_init (&handoff.cond);
+  handoff.pending = gst_queue_array_new_for_struct (sizeof (MicroJob),
+      HANDOFF_DEPTH);
+  gst_deepspeech_ring_init (&handoff.ring, n_samples * HANDOFF_DEPTH);
+
+  worker = g_thread_new ("microbench-worker", handoff_worker, &handoff);
+  TIMED_LOOP (iterations, elapsed, handoff_push (&handoff, samples, n_samples));
+
+  g_mutex_lock (&handoff.lock);
+  handoff.stop = TRUE;
+  g_cond_signal (&handoff.cond);
+  g_mutex_unlock (&handoff.lock);
+  g_thread_join (worker);
+  microbench_sink += handoff.checksum;
+
+  report ("handoff", names[variant], n_samples, iterations, elapsed);
+
+  gst_deepspeech_ring_free (&handoff.ring);
+  gst_queue_array_free (handoff.pending);
+  g_cond_clear (&handoff.cond);
+  g_mutex_clear (&handoff.lock);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gchar **sizes;
+  gint16 *samples;
+  gsize max_samples = 0, i;
+  guint32 seed = 1;
+
+  context = g_option_context_new ("- benchmark the deepspeech element's per-buffer work");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  sizes = g_strsplit (sizes_list, ",", -1);
+  for (i = 0; sizes[i]; i++)
+    max_samples = MAX (max_samples, (gsize) g_ascii_strtoull (sizes[i], NULL, 10));
+
+  /* noise, so that no kernel can take a shortcut on silence */
+  samples = g_new (gint16, MAX (max_samples, 1));
+  for (i = 0; i < max_samples; i++) {
+    seed = seed * 1103515245 + 12345;
+    samples[i] = (gint16) (seed >> 16);
+  }
+
+  printf ("benchmark\tvariant\tsamples\tns/buffer\tns/sample\tMB/s\n");
+  for (i = 0; sizes[i]; i++) {
+    gsize n_samples = (gsize) g_ascii_strtoull (sizes[i], NULL, 10);
+
+    if (n_samples == 0)
+      continue;
+    bench_energy (samples, n_samples);
+    bench_accumulate (samples, n_samples);
+    bench_handoff (samples, n_samples, HANDOFF_COPY);
+    bench_handoff (samples, n_samples, HANDOFF_RING);
+    bench_handoff (samples, n_samples, HANDOFF_ZERO_COPY);
+    fflush (stdout);
+  }
+
+  g_free (samples);
+  g_strfreev (sizes);
+
+  return 0;
+}
@@ -0,0 +1,89 @@
+#!/usr/bin/env python
+
+# Measures how transcription throughput scales with the number of deepspeech
+# elements running in one process.  For each element count N, N independent
+# pipelines transcribe the same file as fast as possible and the aggregate
+# real-time factor (wall clock time / total seconds of audio processed) is
+# printed.  With per-element stream locking the aggregate RTF should fall as
+# N grows until the machine runs out of cores.
+#
+# Usage: concurrency_bench.py /path/to/file.wav [max-elements] [deepspeech properties...]
+
+from __future__ import print_function
+
+import sys
+import time
+
+import gi
+gi.require_version('Gst', '1.0')
+from gi.repository import GLib, Gst
+
+
+def audio_duration(path):
+    pipeline = Gst.parse_launch("filesrc location=\"%s\" ! decodebin ! fakesink" % path)
+    pipeline.set_state(Gst.State.PAUSED)
+    pipeline.get_state(Gst.CLOCK_TIME_NONE)
+    ok, duration = pipeline.query_duration(Gst.Format.TIME)
+    pipeline.set_state(Gst.State.NULL)
+    if not ok:
+        raise RuntimeError("Could not determine the duration of %s" % path)
+    return duration / float(Gst.SECOND)
+
+
+def run(path, count, properties):
+    loop = GLib.MainLoop()
+    pipelines = []
+    remaining = [count]
+
+    def bus_message(bus, message):
+        if message.type in (Gst.MessageType.EOS, Gst.MessageType.ERROR):
+            if message.type == Gst.MessageType.ERROR:
+                print(message.parse_error()[0].message, file=sys.stderr)
+            remaining[0] -= 1
+            if remaining[0] == 0:
+                loop.quit()
+        return True
+
+    for i in range(count):
+        pipeline = Gst.parse_launch(
+            "filesrc location=\"%s\" ! decodebin ! audioconvert ! audiorate ! audioresample ! "
+            "deepspeech %s ! fakesink sync=false" % (path, properties))
+        bus = pipeline.get_bus()
+        bus.add_signal_watch()
+        bus.connect("message", bus_message)
+        pipelines.append(pipeline)
+
+    # Load the (shared) model before starting the clock.
+    for pipeline in pipelines:
+        pipeline.set_state(Gst.State.READY)
+
+    start = time.time()
+    for pipeline in pipelines:
+        pipeline.set_state(Gst.State.PLAYING)
+    loop.run()
+    elapsed = time.time() - start
+
+    for pipeline in pipelines:
+        pipeline.set_state(Gst.State.NULL)
+
+    return elapsed
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: %s FILE [MAX-ELEMENTS] [PROPERTIES...]" % sys.argv[0], file=sys.stderr)
+        sys.exit(1)
+
+    Gst.init(None)
+
+    path = sys.argv[1]
+    max_elements = int(sys.argv[2]) if len(sys.argv) > 2 else 8
+    properties = " ".join(sys.argv[3:])
+    duration = audio_duration(path)
+
+    print("elements\twall (s)\taggregate RTF")
+    count = 1
+    while count <= max_elements:
+        elapsed = run(path, count, properties)
+        print("%d\t%.2f\t%.3f" % (count, elapsed, elapsed / (duration * count)))
+        count *= 2
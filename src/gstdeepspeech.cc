@@ -50,9 +50,46 @@
  * <refsect2>
  * <title>Example launch line</title>
  * |[
- * gst-launch-1.0 -m pulsesrc ! audioconvert ! audiorate ! audioresample ! deepspeech silence-threshold=0.2 silence-length=20 ! fakesink
+ * gst-launch-1.0 -m pulsesrc ! deepspeech silence-threshold=0.05 silence-length=20 ! fakesink
  * ]|
  * </refsect2>
+ *
+ * Results are posted on the bus as "deepspeech" element messages. They can
+ * also be pushed downstream from the optional text_src request pad, as
+ * timestamped text/x-raw buffers or, if downstream prefers
+ * application/json, as JSON objects with the same fields as the message.
+ * Intermediate results are marked with GST_BUFFER_FLAG_DELTA_UNIT.
+ * |[
+ * gst-launch-1.0 pulsesrc ! deepspeech name=ds post-messages=false ! fakesink ds.text_src ! fdsink
+ * ]|
+ *
+ * Input in any of the accepted raw formats is downmixed to mono and
+ * resampled to the model's sample rate internally; the audio passed
+ * downstream is left untouched.
+ *
+ * With split-channels=true each input channel is instead segmented and
+ * decoded on its own, in parallel, such as one speaker per channel of a
+ * call recording. Every result carries the channel it came from.
+ * |[
+ * gst-launch-1.0 -m filesrc location=call.wav ! decodebin ! deepspeech split-channels=true ! fakesink
+ * ]|
+ *
+ * For recordings, mode=offline decodes several segments at once, up to
+ * decoders of them (one per CPU core by default), and still posts the
+ * results in timestamp order.
+ * |[
+ * gst-launch-1.0 -m filesrc location=lecture.wav ! decodebin ! deepspeech mode=offline ! fakesink sync=false
+ * ]|
+ *
+ * In live mode max-latency bounds how far behind the results may fall: a
+ * segment whose audio is older than that by the time it would be decoded is
+ * dropped and reported in a QoS message, as is one the text pad's
+ * downstream has signalled, with a QoS event, it would receive too late.
+ * adaptive-beam narrows the beam while segments are waiting, making such
+ * drops rarer.
+ * |[
+ * gst-launch-1.0 -m pulsesrc ! deepspeech max-latency=5000000000 adaptive-beam=true ! fakesink
+ * ]|
  */
 
 #ifdef HAVE_CONFIG_H
@@ -65,24 +102,69 @@
 #include <sstream>
 
 #include "gstdeepspeech.h"
+#include "gstdeepspeechbatch.h"
+#include "gstdeepspeechdefaults.h"
+#include "gstdeepspeechtrace.h"
 
-GST_DEBUG_CATEGORY_STATIC (gst_deepspeech_debug);
+GST_DEBUG_CATEGORY (gst_deepspeech_debug);
 #define GST_CAT_DEFAULT gst_deepspeech_debug
 
-#define DEFAULT_BEAM_WIDTH 500
+#define DEFAULT_ADAPTIVE_BEAM FALSE
+#define DEFAULT_MIN_BEAM_WIDTH 50
+
+/* The weights the default scorer was built with */
+#define DEFAULT_LM_ALPHA 0.931289039105002
+#define DEFAULT_LM_BETA 1.1834137581510284
 
-#define DEFAULT_SPEECH_MODEL "/usr/share/deepspeech/models/deepspeech-0.9.3-models.pbmm"
-#define DEFAULT_SCORER "/usr/share/deepspeech/models/deepspeech-0.9.3-models.scorer"
-#define DEFAULT_SILENCE_THRESHOLD 0.1
 #define DEFAULT_SILENCE_LENGTH 5
+#define DEFAULT_SILENCE_DURATION 0
+#define MAX_MAX_SEGMENT_DURATION (600 * GST_SECOND)
+#define DEFAULT_MIN_SPEECH_RATIO 0.1
+#define DEFAULT_MIN_SEGMENT_ENERGY 0.0
+#define DEFAULT_MAX_PENDING_SEGMENTS 8
+#define DEFAULT_MAX_LATENCY 0
+#define DEFAULT_STATS_INTERVAL 0
+#define DEFAULT_BACKPRESSURE GST_DEEPSPEECH_BACKPRESSURE_BLOCK
+#define DEFAULT_FEED_MODE GST_DEEPSPEECH_FEED_MODE_SEGMENT
+
+#define DEFAULT_INTERIM_RESULTS_INTERVAL (300 * GST_MSECOND)
+#define DEFAULT_POST_MESSAGES TRUE
+#define DEFAULT_METADATA FALSE
+#define DEFAULT_CANDIDATES 1
+#define MAX_CANDIDATES 100
+#define DEFAULT_SPLIT_CHANNELS FALSE
+#define DEFAULT_MODE GST_DEEPSPEECH_MODE_LIVE
+#define DEFAULT_DECODERS 0
+#define MAX_DECODERS 64
+#define DEFAULT_PRELOAD GST_DEEPSPEECH_PRELOAD_NONE
+#define DEFAULT_RATE 16000
+
+/* Length of one acoustic model time step; a token lasts at least this long */
+#define TOKEN_DURATION (20 * GST_MSECOND)
+
+/* Number of streams kept ready for the next utterance */
+#define STREAM_POOL_SIZE 2
+
+/* The sample ring holds this many maximum length segments (with their
+ * pre-roll): one being decoded, one being accumulated and one queued. In
+ * offline mode there is room for one more per additional worker. */
+#define AUDIO_RING_SEGMENTS 3
+
+/* Initial number of jobs the queue has room for */
+#define PENDING_JOBS_SIZE 16
 
 
 /* Filter signals and args */
 enum
 {
+  SIGNAL_ADD_HOT_WORD,
+  SIGNAL_ERASE_HOT_WORD,
+  SIGNAL_CLEAR_HOT_WORDS,
   LAST_SIGNAL
 };
 
+static guint gst_deepspeech_signals[LAST_SIGNAL] = { 0 };
+
 enum
 {
   PROP_0,
@@ -90,367 +172,2918 @@ enum
   PROP_SCORER,
   PROP_BEAM_WIDTH,
   PROP_SILENCE_THRESHOLD,
-  PROP_SILENCE_LENGTH
+  PROP_SILENCE_LENGTH,
+  PROP_MAX_PENDING_SEGMENTS,
+  PROP_BACKPRESSURE,
+  PROP_FEED_MODE,
+  PROP_INTERIM_RESULTS_INTERVAL,
+  PROP_SILENCE_DURATION,
+  PROP_MAX_SEGMENT_DURATION,
+  PROP_VAD,
+  PROP_PRE_ROLL_DURATION,
+  PROP_MIN_SPEECH_RATIO,
+  PROP_MIN_SEGMENT_ENERGY,
+  PROP_SKIPPED_SEGMENTS,
+  PROP_SKIPPED_DURATION,
+  PROP_POST_MESSAGES,
+  PROP_METADATA,
+  PROP_CANDIDATES,
+  PROP_LM_ALPHA,
+  PROP_LM_BETA,
+  PROP_ADAPTIVE_BEAM,
+  PROP_MIN_BEAM_WIDTH,
+  PROP_SPLIT_CHANNELS,
+  PROP_MODE,
+  PROP_DECODERS,
+  PROP_MAX_LATENCY,
+  PROP_DROPPED_SEGMENTS,
+  PROP_STATS,
+  PROP_STATS_INTERVAL,
+  PROP_PRELOAD
 };
 
+#define GST_TYPE_DEEPSPEECH_BACKPRESSURE (gst_deepspeech_backpressure_get_type ())
+static GType
+gst_deepspeech_backpressure_get_type (void)
+{
+  static GType backpressure_type = 0;
+  static const GEnumValue backpressure_values[] = {
+    {GST_DEEPSPEECH_BACKPRESSURE_BLOCK, "Block upstream until a segment has been decoded", "block"},
+    {GST_DEEPSPEECH_BACKPRESSURE_DROP_OLDEST, "Drop the oldest pending segment", "drop-oldest"},
+    {GST_DEEPSPEECH_BACKPRESSURE_DROP_NEWEST, "Drop the segment which didn't fit", "drop-newest"},
+    {0, NULL, NULL}
+  };
+
+  if (!backpressure_type) {
+    backpressure_type = g_enum_register_static ("GstDeepSpeechBackpressure",
+        backpressure_values);
+  }
+  return backpressure_type;
+}
+
+#define GST_TYPE_DEEPSPEECH_FEED_MODE (gst_deepspeech_feed_mode_get_type ())
+static GType
+gst_deepspeech_feed_mode_get_type (void)
+{
+  static GType feed_mode_type = 0;
+  static const GEnumValue feed_mode_values[] = {
+    {GST_DEEPSPEECH_FEED_MODE_SEGMENT, "Feed each utterance once it has been segmented", "segment"},
+    {GST_DEEPSPEECH_FEED_MODE_INCREMENTAL, "Feed audio as it arrives, overlapping inference with capture", "incremental"},
+    {0, NULL, NULL}
+  };
+
+  if (!feed_mode_type) {
+    feed_mode_type = g_enum_register_static ("GstDeepSpeechFeedMode",
+        feed_mode_values);
+  }
+  return feed_mode_type;
+}
+
+#define GST_TYPE_DEEPSPEECH_MODE (gst_deepspeech_mode_get_type ())
+static GType
+gst_deepspeech_mode_get_type (void)
+{
+  static GType mode_type = 0;
+  static const GEnumValue mode_values[] = {
+    {GST_DEEPSPEECH_MODE_LIVE, "Decode segments one at a time as they are captured", "live"},
+    {GST_DEEPSPEECH_MODE_OFFLINE, "Decode several segments at once, for input faster than real time", "offline"},
+    {0, NULL, NULL}
+  };
+
+  if (!mode_type) {
+    mode_type = g_enum_register_static ("GstDeepSpeechMode", mode_values);
+  }
+  return mode_type;
+}
+
+#define GST_TYPE_DEEPSPEECH_PRELOAD (gst_deepspeech_preload_get_type ())
+static GType
+gst_deepspeech_preload_get_type (void)
+{
+  static GType preload_type = 0;
+  static const GEnumValue preload_values[] = {
+    {GST_DEEPSPEECH_PRELOAD_NONE, "Initialize the model on the first utterance", "none"},
+    {GST_DEEPSPEECH_PRELOAD_WARM_UP, "Warm the model up with a dummy decode when loading it", "warm-up"},
+    {GST_DEEPSPEECH_PRELOAD_LOCK, "Warm the model up and lock its files into memory", "lock"},
+    {0, NULL, NULL}
+  };
+
+  if (!preload_type) {
+    preload_type = g_enum_register_static ("GstDeepSpeechPreload",
+        preload_values);
+  }
+  return preload_type;
+}
+
 /* the capabilities of the inputs and outputs. */
+
 static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("audio/x-raw,format=S16LE,rate=16000,channels=1")
+    GST_STATIC_CAPS (GST_DEEPSPEECH_AUDIO_CAPS)
     );
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("audio/x-raw,format=S16LE,rate=16000,channels=1")
+    GST_STATIC_CAPS (GST_DEEPSPEECH_AUDIO_CAPS)
+    );
+
+static GstStaticPadTemplate text_src_factory = GST_STATIC_PAD_TEMPLATE ("text_src",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS ("text/x-raw,format=utf8; application/json")
     );
 
 #define gst_deepspeech_parent_class parent_class
-G_DEFINE_TYPE (GstDeepSpeech, gst_deepspeech, GST_TYPE_ELEMENT);
+G_DEFINE_TYPE (GstDeepSpeech, gst_deepspeech, GST_TYPE_BASE_TRANSFORM);
+
+/* Where a result lies in the stream. timestamp and duration are counted in
+ * samples fed since the utterance began, the rest is derived from them with
+ * the segment that was current when the audio came in. */
+typedef struct
+{
+  GstClockTime timestamp;
+  GstClockTime duration;
+  GstClockTime running_time;
+  GstClockTime stream_time;
+  GstClockTime end_running_time;
+  GstClockTime end_stream_time;
+} GstDeepSpeechTiming;
 
 static void gst_deepspeech_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_deepspeech_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
+static void gst_deepspeech_finalize (GObject * object);
+static GstStateChangeReturn gst_deepspeech_change_state (GstElement * element,
+    GstStateChange transition);
+static GstPad * gst_deepspeech_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_deepspeech_release_pad (GstElement * element, GstPad * pad);
+static GstIterator * gst_deepspeech_iterate_internal_links (GstPad * pad,
+    GstObject * parent);
+static gboolean gst_deepspeech_text_event (GstPad * pad, GstObject * parent,
+    GstEvent * event);
+static void gst_deepspeech_reset_text_qos (GstDeepSpeech * deepspeech);
+static void gst_deepspeech_push_text (GstDeepSpeech * deepspeech,
+    guint channel, const char * text, const GstDeepSpeechTiming * timing, gboolean intermediate,
+    const Metadata * metadata);
+
+static gboolean gst_deepspeech_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps);
+static gboolean gst_deepspeech_sink_event (GstBaseTransform * trans, GstEvent * event);
+static GstFlowReturn gst_deepspeech_transform_ip (GstBaseTransform * trans, GstBuffer * buf);
+
+static GstMessage * gst_deepspeech_message_new (GstDeepSpeech * deepspeech, guint channel, const GstDeepSpeechTiming * timing, const char * text, bool intermediate, const Metadata * metadata);
+static gboolean gst_deepspeech_load_model (GstDeepSpeech * deepspeech);
+static void gst_deepspeech_unload_model (GstDeepSpeech * deepspeech);
+static gboolean gst_deepspeech_start_worker (GstDeepSpeech * deepspeech,
+    guint n_channels);
+static void gst_deepspeech_end_segments (GstDeepSpeech * deepspeech);
+static void gst_deepspeech_reset_channels (GstDeepSpeech * deepspeech);
+static void gst_deepspeech_stop_worker (GstDeepSpeech * deepspeech);
+static void gst_deepspeech_push_text_event (GstDeepSpeech * deepspeech,
+    GstEvent * event);
+
+static guint64
+gst_deepspeech_duration_to_samples (GstDeepSpeech * deepspeech,
+    GstClockTime duration)
+{
+  return gst_util_uint64_scale_int (duration, deepspeech->rate, GST_SECOND);
+}
 
-static gboolean gst_deepspeech_sink_event (GstPad * pad, GstObject * parent, GstEvent * event);
-static GstFlowReturn gst_deepspeech_chain (GstPad * pad, GstObject * parent, GstBuffer * buf);
-static GstMessage * gst_deepspeech_message_new (GstDeepSpeech * deepspeech, GstBuffer * buf, const char * text, bool intermediate);
-static void gst_deepspeech_load_model (GstDeepSpeech * deepspeech);
+static GstClockTime
+gst_deepspeech_samples_to_duration (GstDeepSpeech * deepspeech,
+    guint64 n_samples)
+{
+  return gst_util_uint64_scale_int (n_samples, GST_SECOND, deepspeech->rate);
+}
 
-static GMutex mutex;
+/* Offline mode decodes segments out of order, so always feeds them whole. */
+static gboolean
+gst_deepspeech_feeds_incrementally (GstDeepSpeech * deepspeech)
+{
+  return !deepspeech->offline &&
+      deepspeech->feed_mode == GST_DEEPSPEECH_FEED_MODE_INCREMENTAL;
+}
 
-gpointer run_model_async(void * instance_data, void * pool_data)
-{ 
-  GstDeepSpeech * deepspeech = GST_DEEPSPEECH (pool_data);
-  GstBuffer * buf = GST_BUFFER (instance_data);
-  GstMapInfo info;
-  char *result;
-
-  gst_buffer_map(buf, &info, GST_MAP_READ);
-  g_mutex_lock(&mutex);
-  void *data = malloc(sizeof(short) * info.size);
-  memcpy(data, info.data, info.size);
-  DS_FeedAudioContent(deepspeech->streaming_state, (const short *) data, (unsigned int) info.size);
-  result = DS_IntermediateDecode(deepspeech->streaming_state);
-  g_mutex_unlock(&mutex);
-
-  if (strlen(result) > 0) {
-    GstMessage *msg = gst_deepspeech_message_new (deepspeech, buf, result, true);
-    gst_element_post_message (GST_ELEMENT (deepspeech), msg);
-  }
+/* Must be called from the streaming thread, while trans->segment is the
+ * segment the audio arrived in. */
+static void
+gst_deepspeech_get_timing (GstDeepSpeech * deepspeech, GstClockTime timestamp,
+    GstClockTime duration, GstDeepSpeechTiming * timing)
+{
+  GstSegment *segment = &GST_BASE_TRANSFORM_CAST (deepspeech)->segment;
+  GstClockTime end = GST_CLOCK_TIME_NONE;
+
+  if (GST_CLOCK_TIME_IS_VALID (timestamp) && GST_CLOCK_TIME_IS_VALID (duration))
+    end = timestamp + duration;
+
+  timing->timestamp = timestamp;
+  timing->duration = duration;
+  timing->running_time = gst_segment_to_running_time (segment, GST_FORMAT_TIME,
+      timestamp);
+  timing->stream_time = gst_segment_to_stream_time (segment, GST_FORMAT_TIME,
+      timestamp);
+  timing->end_running_time = gst_segment_to_running_time (segment,
+      GST_FORMAT_TIME, end);
+  timing->end_stream_time = gst_segment_to_stream_time (segment,
+      GST_FORMAT_TIME, end);
+}
 
-  free(data);
-  gst_buffer_unref(buf);
+/* Number of complete segments waiting to be decoded, over all channels.
+ * Must be called with the queue lock held. */
+static guint
+gst_deepspeech_queue_depth (GstDeepSpeech * deepspeech)
+{
+  guint depth = 0;
+  guint i;
 
-  return NULL;
+  for (i = 0; i < deepspeech->n_channels; i++)
+    depth += deepspeech->channels[i].pending_segments;
+  return depth;
 }
 
-void process_final_text(GstDeepSpeech * deepspeech, GstBuffer *buf) {
-  GstMapInfo info;
-  char *result;
-
-  gst_buffer_map(buf, &info, GST_MAP_READ);
-  void *data = malloc(sizeof(short) * info.size);
-  memcpy(data, info.data, info.size);
-  DS_FeedAudioContent(deepspeech->streaming_state, (const short *) data, (unsigned int) info.size);
-  result = DS_FinishStream(deepspeech->streaming_state);
+/* Snapshot of the statistics, with the queue and drop counters added to
+ * the totals kept in deepspeech->stats. */
+static GstStructure *
+gst_deepspeech_get_stats (GstDeepSpeech * deepspeech)
+{
+  GstStructure *s;
+  guint depth, max_depth;
+  guint64 dropped;
+  GstClockTime dropped_duration;
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  depth = gst_deepspeech_queue_depth (deepspeech);
+  max_depth = deepspeech->max_queue_depth;
+  dropped = deepspeech->dropped_segments;
+  dropped_duration = deepspeech->dropped_duration;
+  g_mutex_unlock (&deepspeech->queue_lock);
+
+  g_mutex_lock (&deepspeech->stats_lock);
+  s = gst_deepspeech_stats_to_structure (&deepspeech->stats, "deepspeech-stats");
+  g_mutex_unlock (&deepspeech->stats_lock);
+
+  gst_structure_set (s,
+      "queue-depth", G_TYPE_UINT, depth,
+      "max-queue-depth", G_TYPE_UINT, max_depth,
+      "dropped-segments", G_TYPE_UINT64, dropped,
+      "dropped-duration", G_TYPE_UINT64, dropped_duration,
+      "skipped-segments", G_TYPE_UINT64, deepspeech->skipped_segments,
+      "skipped-duration", G_TYPE_UINT64, deepspeech->skipped_duration, NULL);
+  return s;
+}
 
-  if (strlen(result) > 0) {
-    GstMessage *msg = gst_deepspeech_message_new (deepspeech, buf, result, false);
-    gst_element_post_message (GST_ELEMENT (deepspeech), msg);
-  }
+/* Posts the statistics as a "deepspeech-stats" element message if
+ * stats-interval has passed since the last time. Called by the workers and
+ * the streaming thread, without any lock held. */
+static void
+gst_deepspeech_maybe_post_stats (GstDeepSpeech * deepspeech)
+{
+  GstClockTime interval = deepspeech->stats_interval;
+  gint64 now;
+  gboolean due;
 
-  free(data);
-  gst_buffer_unref(buf);
+  if (interval == 0)
+    return;
 
-  return;
+  now = g_get_monotonic_time ();
+  g_mutex_lock (&deepspeech->stats_lock);
+  due = (GstClockTime) (now - deepspeech->last_stats_time) * GST_USECOND >= interval;
+  if (due)
+    deepspeech->last_stats_time = now;
+  g_mutex_unlock (&deepspeech->stats_lock);
+
+  if (due)
+    gst_element_post_message (GST_ELEMENT (deepspeech),
+        gst_message_new_element (GST_OBJECT (deepspeech),
+            gst_deepspeech_get_stats (deepspeech)));
 }
 
-/* GObject vmethod implementations */
+/* The beam width for the next stream. With adaptive-beam the configured
+ * width is divided by one more than the number of complete segments
+ * waiting to be decoded, down to min-beam-width, so that a backlog costs
+ * some accuracy instead of ever growing latency. */
+static gint
+gst_deepspeech_stream_beam_width (GstDeepSpeech * deepspeech)
+{
+  gint width = deepspeech->beam_width;
+  guint pending;
 
-/* initialize the deepspeech's class */
+  if (!deepspeech->adaptive_beam)
+    return width;
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  pending = gst_deepspeech_queue_depth (deepspeech);
+  g_mutex_unlock (&deepspeech->queue_lock);
+
+  return MAX (width / (gint) (pending + 1), MIN (width, deepspeech->min_beam_width));
+}
+
+/* Must be called with the stream lock held. */
 static void
-gst_deepspeech_class_init (GstDeepSpeechClass * klass)
+gst_deepspeech_free_spare_streams (GstDeepSpeech * deepspeech)
 {
-  GObjectClass *gobject_class;
-  GstElementClass *gstelement_class;
+  g_queue_foreach (&deepspeech->spare_streams, (GFunc) DS_FreeStream, NULL);
+  g_queue_clear (&deepspeech->spare_streams);
+}
 
-  gobject_class = (GObjectClass *) klass;
-  gstelement_class = (GstElementClass *) klass;
+/* Must be called with the stream lock held. */
+static StreamingState *
+gst_deepspeech_create_stream (GstDeepSpeech * deepspeech, gint beam_width)
+{
+  GstDeepSpeechStreamSettings settings;
 
-  gobject_class->set_property = gst_deepspeech_set_property;
-  gobject_class->get_property = gst_deepspeech_get_property;
+  settings.beam_width = beam_width;
+  settings.hot_words = deepspeech->hot_words;
+  return gst_deepspeech_model_create_stream (deepspeech->model, &settings);
+}
 
-  g_object_class_install_property (gobject_class, PROP_SPEECH_MODEL,
-      g_param_spec_string ("speech-model", "Speech Model", "Location of the speech graph file.",
-          DEFAULT_SPEECH_MODEL, G_PARAM_READWRITE));
-  g_object_class_install_property (gobject_class, PROP_SCORER,
-      g_param_spec_string ("scorer", "Scorer", "Location of the scorer file.",
-          DEFAULT_SCORER, G_PARAM_READWRITE));
-  g_object_class_install_property (gobject_class, PROP_BEAM_WIDTH,
-      g_param_spec_int ("beam-width", "Beam Width", "The beam width used by the decoder. A larger beam width generates better results at the cost of decoding time.",
-          0, G_MAXINT, DEFAULT_BEAM_WIDTH, G_PARAM_READWRITE));
-  g_object_class_install_property (gobject_class, PROP_SILENCE_THRESHOLD,
-      g_param_spec_double ("silence-threshold", "Silence Threshold", "Segment speech when volume is below the threshold for the specified silence length.",
-          0, 1.0, DEFAULT_SILENCE_THRESHOLD, G_PARAM_READWRITE));
-  g_object_class_install_property (gobject_class, PROP_SILENCE_LENGTH,
-      g_param_spec_int ("silence-length", "Silence Length", "Number of buffers which must be below the silence threshold before segmentation occurs.",
-          0, G_MAXINT, DEFAULT_SILENCE_LENGTH, G_PARAM_READWRITE));
+/* Streams keep the scorer, beam width and hot words they were created with,
+ * so spares made with other settings are thrown away. Returns the beam
+ * width for new streams. Must be called with the stream lock held. */
+static gint
+gst_deepspeech_check_spare_streams (GstDeepSpeech * deepspeech)
+{
+  gint width = gst_deepspeech_stream_beam_width (deepspeech);
 
-  gst_element_class_set_details_simple(gstelement_class,
-    "deepspeech",
-    "Filter/Audio",
-    "Performs speech recognition using the Mozilla DeepSpeech model",
-    "Mike Sheldon <elleo@gnu.org>");
+  if (deepspeech->spare_streams_stale || width != deepspeech->spare_beam_width) {
+    GST_DEBUG_OBJECT (deepspeech, "Decoding with beam width %d", width);
+    gst_deepspeech_free_spare_streams (deepspeech);
+    deepspeech->spare_beam_width = width;
+    deepspeech->spare_streams_stale = FALSE;
+  }
+  return width;
+}
 
-  gst_element_class_add_pad_template (gstelement_class,
-      gst_static_pad_template_get (&src_factory));
-  gst_element_class_add_pad_template (gstelement_class,
-      gst_static_pad_template_get (&sink_factory));
+/* Takes a stream for the next utterance, preferably one created ahead of
+ * time so that finishing an utterance doesn't wait for an allocation.
+ * Must be called with the stream lock held. */
+static StreamingState *
+gst_deepspeech_next_stream (GstDeepSpeech * deepspeech)
+{
+  StreamingState *stream;
+  gint width = gst_deepspeech_check_spare_streams (deepspeech);
 
-  g_mutex_init(&mutex);
+  stream = (StreamingState *) g_queue_pop_head (&deepspeech->spare_streams);
+  if (stream == NULL)
+    stream = gst_deepspeech_create_stream (deepspeech, width);
+  return stream;
 }
 
-/* initialize the new element
- * instantiate pads and add them to element
- * set pad calback functions
- * initialize instance structure
- */
+/* Tops the spare stream pool back up, off the critical path once an
+ * utterance's result has been posted. Must be called with the stream lock
+ * held. */
 static void
-gst_deepspeech_init (GstDeepSpeech * deepspeech)
+gst_deepspeech_refill_streams (GstDeepSpeech * deepspeech)
 {
-  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (deepspeech);
-  deepspeech->sinkpad = gst_pad_new_from_static_template (&sink_factory, "sink");
-  gst_segment_init (&trans->segment, GST_FORMAT_TIME);
-  gst_pad_set_event_function (deepspeech->sinkpad,
-                              GST_DEBUG_FUNCPTR(gst_deepspeech_sink_event));
-  gst_pad_set_chain_function (deepspeech->sinkpad,
-                              GST_DEBUG_FUNCPTR(gst_deepspeech_chain));
-  GST_PAD_SET_PROXY_CAPS (deepspeech->sinkpad);
-  gst_element_add_pad (GST_ELEMENT (deepspeech), deepspeech->sinkpad);
-
-  deepspeech->srcpad = gst_pad_new_from_static_template (&src_factory, "src");
-  GST_PAD_SET_PROXY_CAPS (deepspeech->srcpad);
-  gst_element_add_pad (GST_ELEMENT (deepspeech), deepspeech->srcpad);
+  StreamingState *stream;
+  gint width = gst_deepspeech_check_spare_streams (deepspeech);
 
-  deepspeech->speech_model_path = g_strdup (DEFAULT_SPEECH_MODEL);
-  deepspeech->scorer_path = g_strdup (DEFAULT_SCORER);
-  deepspeech->beam_width = DEFAULT_BEAM_WIDTH;
-  deepspeech->silence_threshold = DEFAULT_SILENCE_THRESHOLD;
-  deepspeech->silence_length = DEFAULT_SILENCE_LENGTH;
-  deepspeech->quiet_bufs = 0;
-  gst_deepspeech_load_model (deepspeech);
-  deepspeech->buf = gst_buffer_new();
-  deepspeech->thread_pool = g_thread_pool_new((GFunc) run_model_async, (gpointer) deepspeech, -1, FALSE, NULL);
+  while (g_queue_get_length (&deepspeech->spare_streams) < STREAM_POOL_SIZE) {
+    stream = gst_deepspeech_create_stream (deepspeech, width);
+    if (stream == NULL)
+      break;
+    g_queue_push_tail (&deepspeech->spare_streams, stream);
+  }
 }
 
+/* Makes the next utterance use the current settings. Must be called with
+ * the stream lock held. */
 static void
-gst_deepspeech_load_model (GstDeepSpeech * deepspeech)
+gst_deepspeech_renew_spare_streams (GstDeepSpeech * deepspeech)
 {
-  int status = DS_CreateModel(deepspeech->speech_model_path, &deepspeech->model_state);
-  if (status != 0) {
-    fprintf(stderr, "Could not create model.\n");
-    return;
-  }
+  deepspeech->spare_streams_stale = TRUE;
+  if (deepspeech->model)
+    gst_deepspeech_refill_streams (deepspeech);
+}
 
-  DS_SetModelBeamWidth(deepspeech->model_state, DEFAULT_BEAM_WIDTH);
+/* Applies the weights set on the element to the scorer, taking the other
+ * one from the scorer when only one of them was set. The weights belong to
+ * the scorer, so they also change for the other elements sharing it.
+ * Called with the stream lock held. */
+static void
+gst_deepspeech_apply_lm_params (GstDeepSpeech * deepspeech)
+{
+  gfloat alpha, beta;
 
-  status = DS_EnableExternalScorer(deepspeech->model_state, deepspeech->scorer_path); 
-  if (status != 0) {
-    fprintf(stderr, "Could not enable scorer.\n");
+  if (!deepspeech->model || (!deepspeech->lm_alpha_set &&
+          !deepspeech->lm_beta_set))
     return;
-  }
 
-  status = DS_CreateStream(deepspeech->model_state, &deepspeech->streaming_state);
-  if (status != 0) {
-    fprintf(stderr, "Could not create stream.\n");
+  if (!gst_deepspeech_model_get_alpha_beta (deepspeech->model, &alpha, &beta)
+      && !(deepspeech->lm_alpha_set && deepspeech->lm_beta_set)) {
+    GST_WARNING_OBJECT (deepspeech, "Could not read the weights of scorer %s, "
+        "set both lm-alpha and lm-beta to change them", deepspeech->scorer_path);
     return;
   }
+  if (deepspeech->lm_alpha_set)
+    alpha = deepspeech->lm_alpha;
+  if (deepspeech->lm_beta_set)
+    beta = deepspeech->lm_beta;
+  gst_deepspeech_model_set_alpha_beta (deepspeech->model, alpha, beta);
 }
 
+/* Switches scorers from the next utterance without reloading the acoustic
+ * model. The new scorer is loaded here, on the calling thread, while
+ * decoding waits; if it fails to load the previous one stays in use. A
+ * model shared with other elements keeps its scorer, and the new one is
+ * used once the model is next loaded. */
 static void
-gst_deepspeech_set_property (GObject * object, guint prop_id,
-    const GValue * value, GParamSpec * pspec)
+gst_deepspeech_set_scorer (GstDeepSpeech * deepspeech, const gchar * scorer_path)
 {
-  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (object);
-
-  switch (prop_id) {
-    case PROP_SPEECH_MODEL:
-      deepspeech->speech_model_path = g_value_dup_string (value);
-      gst_deepspeech_load_model (deepspeech);
-      break;
-    case PROP_SCORER:
-      deepspeech->scorer_path = g_value_dup_string (value);
-      gst_deepspeech_load_model (deepspeech);
-      break;
-    case PROP_BEAM_WIDTH:
-      deepspeech->beam_width = g_value_get_int (value);
-      gst_deepspeech_load_model (deepspeech);
-      break;
-    case PROP_SILENCE_THRESHOLD:
-      deepspeech->silence_threshold = g_value_get_double (value);
-      break;
-    case PROP_SILENCE_LENGTH:
-      deepspeech->silence_length = g_value_get_int (value);
-      break;
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-      break;
+  gchar *previous;
+  gboolean shared;
+
+  g_mutex_lock (&deepspeech->stream_lock);
+  previous = deepspeech->scorer_path;
+  deepspeech->scorer_path = g_strdup (scorer_path);
+  if (deepspeech->model) {
+    if (gst_deepspeech_model_switch_scorer (deepspeech->model, scorer_path,
+            &shared)) {
+      gst_deepspeech_renew_spare_streams (deepspeech);
+      gst_deepspeech_apply_lm_params (deepspeech);
+    } else if (shared) {
+      GST_INFO_OBJECT (deepspeech, "The model is shared with other elements, "
+          "scorer %s applies when it is next loaded", scorer_path);
+    } else {
+      GST_ELEMENT_WARNING (deepspeech, RESOURCE, OPEN_READ,
+          ("Could not load scorer."), ("scorer=%s", scorer_path));
+      g_free (deepspeech->scorer_path);
+      deepspeech->scorer_path = previous;
+      previous = NULL;
+    }
   }
+  g_mutex_unlock (&deepspeech->stream_lock);
+  g_free (previous);
 }
 
+/* Hot words take effect from the next utterance. */
 static void
-gst_deepspeech_get_property (GObject * object, guint prop_id,
-    GValue * value, GParamSpec * pspec)
+gst_deepspeech_add_hot_word (GstDeepSpeech * deepspeech, const gchar * word,
+    gfloat boost)
 {
-  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (object);
+  gfloat *value;
 
-  switch (prop_id) {
-    case PROP_SPEECH_MODEL:
-      g_value_set_string (value, deepspeech->speech_model_path);
-      break;
-    case PROP_SCORER:
-      g_value_set_string (value, deepspeech->scorer_path);
-      break;
-    case PROP_BEAM_WIDTH:
-      g_value_set_int (value, deepspeech->beam_width);
-      break;
-    case PROP_SILENCE_THRESHOLD:
-      g_value_set_double (value, deepspeech->silence_threshold);
-      break;
-    case PROP_SILENCE_LENGTH:
-      g_value_set_int (value, deepspeech->silence_length);
-      break;
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-      break;
-  }
+  g_return_if_fail (word != NULL);
+
+  value = g_new (gfloat, 1);
+  *value = boost;
+  g_mutex_lock (&deepspeech->stream_lock);
+  g_hash_table_insert (deepspeech->hot_words, g_strdup (word), value);
+  gst_deepspeech_renew_spare_streams (deepspeech);
+  g_mutex_unlock (&deepspeech->stream_lock);
 }
 
-static GstMessage *
-gst_deepspeech_message_new (GstDeepSpeech * deepspeech, GstBuffer * buf, const char * text, bool intermediate)
+static void
+gst_deepspeech_erase_hot_word (GstDeepSpeech * deepspeech, const gchar * word)
 {
-  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (deepspeech);
-  GstStructure *s;
-  GstClockTime running_time, stream_time;
+  g_return_if_fail (word != NULL);
 
-  running_time = gst_segment_to_running_time (&trans->segment, GST_FORMAT_TIME,
-      GST_BUFFER_TIMESTAMP (buf));
-  stream_time = gst_segment_to_stream_time (&trans->segment, GST_FORMAT_TIME,
-      GST_BUFFER_TIMESTAMP (buf));
+  g_mutex_lock (&deepspeech->stream_lock);
+  if (g_hash_table_remove (deepspeech->hot_words, word))
+    gst_deepspeech_renew_spare_streams (deepspeech);
+  g_mutex_unlock (&deepspeech->stream_lock);
+}
 
-  s = gst_structure_new ("deepspeech",
-      "timestamp", G_TYPE_UINT64, GST_BUFFER_TIMESTAMP (buf),
-      "stream-time", G_TYPE_UINT64, stream_time,
-      "running-time", G_TYPE_UINT64, running_time,
-      "intermediate", G_TYPE_BOOLEAN, intermediate,
-      "text", G_TYPE_STRING, text, NULL);
+static void
+gst_deepspeech_clear_hot_words (GstDeepSpeech * deepspeech)
+{
+  g_mutex_lock (&deepspeech->stream_lock);
+  if (g_hash_table_size (deepspeech->hot_words) > 0) {
+    g_hash_table_remove_all (deepspeech->hot_words);
+    gst_deepspeech_renew_spare_streams (deepspeech);
+  }
+  g_mutex_unlock (&deepspeech->stream_lock);
+}
 
-  return gst_message_new_element (GST_OBJECT (deepspeech), s);
+/* The decoder's tokens are characters, so a candidate's text is all of them
+ * joined together. */
+static gchar *
+gst_deepspeech_candidate_text (const CandidateTranscript * candidate)
+{
+  GString *text = g_string_new (NULL);
+  guint i;
+
+  for (i = 0; i < candidate->num_tokens; i++)
+    g_string_append (text, candidate->tokens[i].text);
+  return g_string_free (text, FALSE);
 }
 
-/* GstElement vmethod implementations */
+typedef void (*GstDeepSpeechWordFunc) (const gchar * word, GstClockTime start,
+    GstClockTime end, gpointer user_data);
 
-/* this function handles sink events */
-static gboolean
-gst_deepspeech_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+/* Calls func for each space separated word of the candidate, with the time
+ * of its first token and the time of the space after it, relative to the
+ * start of the utterance. The last word ends a time step after its last
+ * token. */
+static void
+gst_deepspeech_foreach_word (const CandidateTranscript * candidate,
+    GstDeepSpeechWordFunc func, gpointer user_data)
 {
-  GstDeepSpeech *deepspeech;
-  gboolean ret;
+  GString *word = g_string_new (NULL);
+  GstClockTime start = 0, last = 0;
+  guint i;
+
+  for (i = 0; i < candidate->num_tokens; i++) {
+    const TokenMetadata *token = &candidate->tokens[i];
+    GstClockTime time = (GstClockTime) (token->start_time * GST_SECOND);
+
+    if (strcmp (token->text, " ") == 0) {
+      if (word->len > 0)
+        func (word->str, start, time, user_data);
+      g_string_truncate (word, 0);
+      continue;
+    }
+    if (word->len == 0)
+      start = time;
+    last = time;
+    g_string_append (word, token->text);
+  }
+  if (word->len > 0)
+    func (word->str, start, last + TOKEN_DURATION, user_data);
 
-  deepspeech = GST_DEEPSPEECH (parent);
+  g_string_free (word, TRUE);
+}
 
-  GST_LOG_OBJECT (deepspeech, "Received %s event: %" GST_PTR_FORMAT,
-      GST_EVENT_TYPE_NAME (event), event);
+/* Work handed from the streaming thread to a channel's worker. In segment
+ * mode every job carries a whole utterance, in incremental mode each
+ * upstream buffer is fed as soon as it arrives and a separate job marks the
+ * end of the utterance. An utterance that turned out not to be speech is
+ * ended with a discard job, which throws the stream away without decoding
+ * it. Backpressure dropping an utterance that has already started feeding
+ * leaves a discard job in its place too, marked dropped, which doesn't
+ * count as a pending segment.
+ *
+ * Jobs don't hold the audio itself but the range of it in the channel's
+ * sample ring, and are queued by value, so handing one over allocates
+ * nothing. */
+typedef enum
+{
+  GST_DEEPSPEECH_JOB_SEGMENT,
+  GST_DEEPSPEECH_JOB_FEED,
+  GST_DEEPSPEECH_JOB_END,
+  GST_DEEPSPEECH_JOB_DISCARD
+} GstDeepSpeechJobType;
 
-  switch (GST_EVENT_TYPE (event)) {
-    case GST_EVENT_CAPS:
-      GstCaps * caps;
+typedef struct
+{
+  GstDeepSpeechJobType type;
+  guint64 offset;
+  gsize n_samples;
+  GstDeepSpeechTiming timing;
+  gint64 queued;
+  gboolean dropped;
+} GstDeepSpeechJob;
+
+#define GST_DEEPSPEECH_JOB_ENDS_SEGMENT(job) ((job)->type != GST_DEEPSPEECH_JOB_FEED)
+
+/* segment_offset when no segment is being accumulated in the ring. While
+ * one is, segment_offset is where its audio not yet handed to a worker
+ * starts: the whole segment, or in incremental mode whatever was written
+ * since the last feed job was queued. */
+#define GST_DEEPSPEECH_NO_OFFSET G_MAXUINT64
+
+/* The audio of a job, as the up to two contiguous spans it occupies in the
+ * ring. */
+typedef struct
+{
+  const gint16 *data[2];
+  gsize len[2];
+} GstDeepSpeechSpans;
 
-      gst_event_parse_caps (event, &caps);
-      ret = gst_pad_event_default (pad, parent, event);
-      break;
-    case GST_EVENT_EOS:
-      g_thread_pool_free(deepspeech->thread_pool, FALSE, TRUE);
-      process_final_text(deepspeech, gst_buffer_copy_deep(deepspeech->buf));
-      ret = gst_pad_event_default (pad, parent, event);
-      break;
-    default:
-      ret = gst_pad_event_default (pad, parent, event);
-      break;
+static void
+gst_deepspeech_feed_spans (StreamingState * stream,
+    const GstDeepSpeechSpans * spans)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (spans->data); i++) {
+    if (spans->len[i] > 0)
+      DS_FeedAudioContent (stream, spans->data[i], (unsigned int) spans->len[i]);
   }
-  return ret;
 }
 
-/* chain function
- * this function does the actual processing
- */
-static GstFlowReturn
-gst_deepspeech_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+/* A job a worker has taken, with its result once decoded. A channel's jobs
+ * are kept in the order they were queued until their results have been
+ * posted, so with several workers a short segment decoded before a long one
+ * that came earlier waits for it, and results come out in timestamp
+ * order. Results of jobs taken before the last flush, whose epoch is
+ * behind the element's, are dropped, as are any completed while flushing. */
+typedef struct
 {
-  GstDeepSpeech *deepspeech;
-  deepspeech = GST_DEEPSPEECH (parent);
+  GstDeepSpeechJob job;
+  GstDeepSpeechSpans spans;
+  guint epoch;
+  gboolean done;
+  gboolean interim;
+  gchar *text;
+  Metadata *metadata;
+} GstDeepSpeechDecode;
 
-  GstMapInfo info;
-  gint16 *in;
-  register guint j;
-  gdouble squaresum = 0.0;
-  register gdouble square = 0.0;
-  register gdouble peaksquare = 0.0;
-  gdouble normalizer;
-  gdouble ncs = 0.0;
-
-  gst_buffer_map(buf, &info, GST_MAP_READ);
-  in = (gint16 *)info.data;
+static void
+gst_deepspeech_decode_free (GstDeepSpeechDecode * decode)
+{
+  g_free (decode->text);
+  if (decode->metadata)
+    DS_FreeMetadata (decode->metadata);
+  g_free (decode);
+}
 
-  for (j = 0; j < info.size/2; j += 1) {
-    square = ((gdouble) in[j]) * in[j];
-    if (square > peaksquare) peaksquare = square;
-    squaresum += square;
+/* Whether a job's audio ended so long ago that decoding it would put the
+ * result more than max-latency behind the pipeline clock, or the text pad's
+ * downstream has reported it would arrive too late to be of use. Only live
+ * pipelines in PLAYING have a clock to be late against. */
+static gboolean
+gst_deepspeech_job_is_late (GstDeepSpeech * deepspeech,
+    const GstDeepSpeechJob * job, GstClockTimeDiff * jitter)
+{
+  GstClockTime end = job->timing.end_running_time;
+  GstClockTime now = GST_CLOCK_TIME_NONE, earliest;
+  GstClock *clock;
+
+  if (deepspeech->offline || !GST_CLOCK_TIME_IS_VALID (end))
+    return FALSE;
+
+  GST_OBJECT_LOCK (deepspeech);
+  clock = GST_ELEMENT_CLOCK (deepspeech);
+  if (clock && deepspeech->max_latency > 0 &&
+      GST_STATE (deepspeech) == GST_STATE_PLAYING)
+    now = gst_clock_get_time (clock) - GST_ELEMENT_CAST (deepspeech)->base_time;
+  earliest = deepspeech->text_earliest_time;
+  GST_OBJECT_UNLOCK (deepspeech);
+
+  if (GST_CLOCK_TIME_IS_VALID (now) && now > end + deepspeech->max_latency) {
+    *jitter = GST_CLOCK_DIFF (end, now);
+    return TRUE;
+  }
+  if (GST_CLOCK_TIME_IS_VALID (earliest) && end < earliest) {
+    *jitter = GST_CLOCK_DIFF (end, earliest);
+    return TRUE;
   }
+  return FALSE;
+}
 
-  normalizer = (gdouble) (G_GINT64_CONSTANT(1) << 30);
-  ncs = squaresum / normalizer;
+/* Counts a segment dropped for being late and reports it in a QoS message,
+ * whose stats are the amount of audio decoded and dropped so far. */
+static void
+gst_deepspeech_drop_late_segment (GstDeepSpeech * deepspeech,
+    const GstDeepSpeechJob * job, GstClockTimeDiff jitter)
+{
+  GstMessage *msg;
+  GstClockTime processed, dropped;
+  gdouble proportion;
+
+  GST_DEBUG_OBJECT (deepspeech, "Dropping segment at %" GST_TIME_FORMAT
+      ", %" GST_STIME_FORMAT " late", GST_TIME_ARGS (job->timing.timestamp),
+      GST_STIME_ARGS (jitter));
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  deepspeech->dropped_segments++;
+  deepspeech->dropped_duration += job->timing.duration;
+  dropped = deepspeech->dropped_duration;
+  g_mutex_unlock (&deepspeech->queue_lock);
+
+  g_mutex_lock (&deepspeech->stats_lock);
+  processed = deepspeech->stats.decoded_duration;
+  g_mutex_unlock (&deepspeech->stats_lock);
+
+  GST_OBJECT_LOCK (deepspeech);
+  proportion = deepspeech->text_proportion;
+  GST_OBJECT_UNLOCK (deepspeech);
+
+  msg = gst_message_new_qos (GST_OBJECT (deepspeech), TRUE,
+      job->timing.running_time, job->timing.stream_time, job->timing.timestamp,
+      job->timing.duration);
+  gst_message_set_qos_values (msg, jitter, proportion, 1000000);
+  gst_message_set_qos_stats (msg, GST_FORMAT_TIME, processed, dropped);
+  gst_element_post_message (GST_ELEMENT (deepspeech), msg);
+}
 
-  gst_buffer_ref(buf);
-  deepspeech->buf = gst_buffer_append(deepspeech->buf, buf);
+/* Accounts for a job's time in the model. In incremental mode an
+ * utterance's feed time adds up over its jobs, which only the channel's
+ * single worker touches. */
+static void
+gst_deepspeech_add_job_stats (GstDeepSpeechChannel * channel,
+    const GstDeepSpeechJob * job, GstDeepSpeechJobType type,
+    GstClockTime lock_wait, GstClockTime feed_time, GstClockTime processing_time)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  GstDeepSpeechStats *stats = &deepspeech->stats;
 
-  if (ncs < deepspeech->silence_threshold && gst_buffer_get_size(deepspeech->buf) > 0) {
-    deepspeech->quiet_bufs++;
-  } else {
-    deepspeech->quiet_bufs = 0;
+  if (type == GST_DEEPSPEECH_JOB_FEED || type == GST_DEEPSPEECH_JOB_END ||
+      type == GST_DEEPSPEECH_JOB_DISCARD) {
+    feed_time += channel->feed_time;
+    channel->feed_time = type == GST_DEEPSPEECH_JOB_FEED ? feed_time : 0;
+  }
+
+  g_mutex_lock (&deepspeech->stats_lock);
+  stats->fed_duration += gst_deepspeech_samples_to_duration (deepspeech,
+      job->n_samples);
+  stats->processing_time += processing_time;
+  stats->lock_wait_time += lock_wait;
+  if (GST_DEEPSPEECH_JOB_ENDS_SEGMENT (job) && type != GST_DEEPSPEECH_JOB_DISCARD) {
+    stats->decoded_segments++;
+    stats->decoded_duration += job->timing.duration;
+    gst_deepspeech_stats_add_latency (stats->feed_latency, feed_time);
+    gst_deepspeech_stats_add_latency (stats->decode_latency,
+        (g_get_monotonic_time () - job->queued) * GST_USECOND);
+  }
+  g_mutex_unlock (&deepspeech->stats_lock);
+}
+
+/* Feeds the job's audio to the worker's stream and, at the end of an
+ * utterance, finishes the stream and keeps the final text. Every utterance
+ * gets a fresh stream so decoding doesn't slow down as a long session
+ * accumulates beam state.
+ *
+ * In incremental mode a partial result is decoded each time another
+ * interim-results-interval of audio has been fed, and kept if its text
+ * differs from the previous one.
+ *
+ * With metadata enabled the decoder's metadata variants are used instead,
+ * and the best candidate provides the text.
+ *
+ * A segment that is late is dropped instead: whole segments aren't fed at
+ * all, and in incremental mode the rest of the utterance is left unfed and
+ * the stream thrown away at its end. */
+static void process_job(GstDeepSpeechChannel * channel, StreamingState ** stream,
+    GstDeepSpeechDecode * decode)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  const GstDeepSpeechJob *job = &decode->job;
+  GstDeepSpeechJobType type = job->type;
+  char *result = NULL;
+  Metadata *metadata = NULL;
+  gboolean ends_segment = GST_DEEPSPEECH_JOB_ENDS_SEGMENT (job);
+  gboolean interim = FALSE;
+  gboolean with_metadata = deepspeech->metadata;
+  unsigned int candidates = deepspeech->candidates;
+  GstClockTimeDiff jitter = 0;
+  gint64 start, locked, fed, end;
+  GstClockTime trace, trace_decode;
+
+  if (type != GST_DEEPSPEECH_JOB_DISCARD &&
+      (gst_deepspeech_job_is_late (deepspeech, job, &jitter) || channel->late_segment)) {
+    channel->late_segment = !ends_segment;
+    if (!ends_segment)
+      return;
+    gst_deepspeech_drop_late_segment (deepspeech, job, jitter);
+    if (type == GST_DEEPSPEECH_JOB_SEGMENT)
+      return;
+    type = GST_DEEPSPEECH_JOB_DISCARD;
   }
 
-  if (deepspeech->quiet_bufs > deepspeech->silence_length && gst_buffer_get_size(deepspeech->buf) > 0) {
-      g_thread_pool_push(deepspeech->thread_pool, (gpointer) gst_buffer_copy_deep(deepspeech->buf), NULL);
+  if (*stream == NULL) {
+    g_mutex_lock(&deepspeech->stream_lock);
+    *stream = gst_deepspeech_next_stream(deepspeech);
+    g_mutex_unlock(&deepspeech->stream_lock);
+  }
+  if (*stream == NULL) {
+    GST_WARNING_OBJECT (deepspeech, "No stream available, dropping audio");
+    return;
+  }
 
-      gst_buffer_unref(deepspeech->buf);
+  if (job->type == GST_DEEPSPEECH_JOB_FEED && deepspeech->interim_results_interval > 0) {
+    channel->interim_samples += job->n_samples;
+    interim = channel->interim_samples >= gst_deepspeech_duration_to_samples (
+        deepspeech, deepspeech->interim_results_interval);
+  }
 
-      deepspeech->buf = gst_buffer_new();
-      deepspeech->quiet_bufs = 0;
+  start = g_get_monotonic_time ();
+  gst_deepspeech_model_lock(deepspeech->model);
+  locked = g_get_monotonic_time ();
+  trace = GST_DEEPSPEECH_TRACE_START ();
+  gst_deepspeech_feed_spans(*stream, &decode->spans);
+  fed = g_get_monotonic_time ();
+  GST_DEEPSPEECH_TRACE (GST_DEEPSPEECH_TRACE_FEED, deepspeech, channel->index,
+      trace, job->n_samples);
+  trace_decode = GST_DEEPSPEECH_TRACE_START ();
+  if (type == GST_DEEPSPEECH_JOB_DISCARD)
+    DS_FreeStream(*stream);
+  else if (ends_segment && with_metadata)
+    metadata = DS_FinishStreamWithMetadata(*stream, candidates);
+  else if (ends_segment)
+    result = DS_FinishStream(*stream);
+  else if (interim && with_metadata)
+    metadata = DS_IntermediateDecodeWithMetadata(*stream, candidates);
+  else if (interim)
+    result = DS_IntermediateDecode(*stream);
+  gst_deepspeech_model_unlock(deepspeech->model);
+  end = g_get_monotonic_time ();
+  if (type != GST_DEEPSPEECH_JOB_DISCARD && ends_segment)
+    GST_DEEPSPEECH_TRACE (GST_DEEPSPEECH_TRACE_FINISH, deepspeech, channel->index,
+        trace_decode, 0);
+  else if (interim)
+    GST_DEEPSPEECH_TRACE (GST_DEEPSPEECH_TRACE_INTERMEDIATE_DECODE, deepspeech,
+        channel->index, trace_decode, 0);
+
+  if (ends_segment) {
+    /* DS_FinishStream frees the stream too */
+    g_mutex_lock(&deepspeech->stream_lock);
+    *stream = gst_deepspeech_next_stream(deepspeech);
+    g_mutex_unlock(&deepspeech->stream_lock);
+  }
+  gst_deepspeech_add_job_stats (channel, job, type, (locked - start) * GST_USECOND,
+      (fed - locked) * GST_USECOND, (end - locked) * GST_USECOND);
+
+  if (result) {
+    decode->text = g_strdup (result);
+    DS_FreeString(result);
+  } else if (metadata) {
+    decode->text = metadata->num_transcripts > 0 ?
+        gst_deepspeech_candidate_text (&metadata->transcripts[0]) : g_strdup ("");
+  }
+  decode->metadata = metadata;
+
+  if (interim) {
+    channel->interim_samples = 0;
+    if (decode->text && g_strcmp0 (decode->text, channel->last_interim) != 0) {
+      g_free (channel->last_interim);
+      channel->last_interim = g_strdup (decode->text);
+      decode->interim = TRUE;
+    } else {
+      g_clear_pointer (&decode->text, g_free);
+    }
   }
 
-  /* just push out the incoming buffer without touching it */
-  return gst_pad_push (deepspeech->srcpad, buf);
+  if (ends_segment) {
+    channel->interim_samples = 0;
+    g_free (channel->last_interim);
+    channel->last_interim = NULL;
+  }
 }
 
+/* Posts the result of a decoded job on the bus and pushes it from the text
+ * pad. */
+static void
+gst_deepspeech_post_result (GstDeepSpeechChannel * channel,
+    const GstDeepSpeechDecode * decode)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+
+  if (decode->text == NULL || strlen (decode->text) == 0)
+    return;
 
-/* entry point to initialize the plug-in
- * initialize the plug-in itself
- * register the element factories and other features
- */
+  if (deepspeech->post_messages) {
+    GstMessage *msg = gst_deepspeech_message_new (deepspeech, channel->index,
+        &decode->job.timing, decode->text, decode->interim, decode->metadata);
+    gst_element_post_message (GST_ELEMENT (deepspeech), msg);
+  }
+  gst_deepspeech_push_text (deepspeech, channel->index, decode->text,
+      &decode->job.timing, decode->interim, decode->metadata);
+}
+
+/* Whether every queued segment of every channel has been decoded and its
+ * result posted. Must be called with the queue lock held. */
 static gboolean
-deepspeech_init (GstPlugin * deepspeech)
+gst_deepspeech_is_idle (GstDeepSpeech * deepspeech)
 {
-  /* debug category for filtering log messages
-   */
-  GST_DEBUG_CATEGORY_INIT (gst_deepspeech_debug, "deepspeech",
-      0, "Performs speech recognition using Mozilla's DeepSpeech model.");
+  guint i;
+
+  for (i = 0; i < deepspeech->n_channels; i++) {
+    GstDeepSpeechChannel *channel = &deepspeech->channels[i];
+
+    if (channel->posting || !g_queue_is_empty (&channel->decoding) ||
+        !gst_queue_array_is_empty (channel->pending))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* Sends on an EOS that was held back while segments were still being
+ * decoded, once the last of their results is out. Must be called with the
+ * queue lock held, which is released while pushing. */
+static void
+gst_deepspeech_forward_eos (GstDeepSpeech * deepspeech)
+{
+  GstEvent *eos = deepspeech->pending_eos;
+
+  if (eos == NULL || deepspeech->flushing || !gst_deepspeech_is_idle (deepspeech))
+    return;
+
+  deepspeech->pending_eos = NULL;
+  deepspeech->forwarding_eos = TRUE;
+  g_mutex_unlock (&deepspeech->queue_lock);
+
+  GST_DEBUG_OBJECT (deepspeech, "Decoding finished, forwarding EOS");
+  gst_deepspeech_push_text_event (deepspeech, gst_event_new_eos ());
+  gst_pad_push_event (GST_BASE_TRANSFORM_SRC_PAD (deepspeech), eos);
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  deepspeech->forwarding_eos = FALSE;
+  g_cond_broadcast (&deepspeech->queue_cond);
+}
+
+/* Posts the results of the channel's oldest jobs that have been decoded, in
+ * order, and forwards a held back EOS once they are all out. Only one
+ * worker posts at a time; the others just mark their jobs done and leave
+ * them to it. Must be called with the queue lock held, which is released
+ * while posting. */
+static void
+gst_deepspeech_post_results (GstDeepSpeechChannel * channel)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  GstDeepSpeechDecode *decode;
+  gboolean stale;
+
+  if (channel->posting)
+    return;
+
+  channel->posting = TRUE;
+  while ((decode = (GstDeepSpeechDecode *) g_queue_peek_head (&channel->decoding)) &&
+      decode->done) {
+    g_queue_pop_head (&channel->decoding);
+    stale = decode->epoch != deepspeech->epoch || deepspeech->flushing;
+    g_mutex_unlock (&deepspeech->queue_lock);
+
+    if (!stale)
+      gst_deepspeech_post_result (channel, decode);
+    gst_deepspeech_decode_free (decode);
+
+    g_mutex_lock (&deepspeech->queue_lock);
+  }
+  channel->posting = FALSE;
+  g_cond_broadcast (&deepspeech->queue_cond);
+
+  gst_deepspeech_forward_eos (deepspeech);
+}
+
+/* Hands the ring space of audio nobody needs any more back to the streaming
+ * thread: everything before the oldest job still being decoded, the oldest
+ * queued job and the segment still being accumulated. Must be called with
+ * the queue lock held. */
+static void
+gst_deepspeech_release_audio (GstDeepSpeechChannel * channel)
+{
+  GstDeepSpeechJob *job;
+  GList *l;
+  guint64 keep = channel->audio.end;
+
+  for (l = channel->decoding.head; l; l = l->next) {
+    GstDeepSpeechDecode *decode = (GstDeepSpeechDecode *) l->data;
+
+    if (!decode->done) {
+      keep = MIN (keep, decode->job.offset);
+      break;
+    }
+  }
+  job = (GstDeepSpeechJob *) gst_queue_array_peek_head_struct (channel->pending);
+  if (job)
+    keep = MIN (keep, job->offset);
+  keep = MIN (keep, channel->segment_offset);
+
+  gst_deepspeech_ring_release (&channel->audio, keep);
+  g_cond_broadcast (&channel->deepspeech->queue_cond);
+}
+
+/* Each channel's jobs are processed by worker threads of its own, fed from
+ * a queue holding at most max-pending-segments complete segments. Live mode
+ * has a single worker, so jobs are decoded in order; in offline mode
+ * several workers take the next queued segment as soon as they are free,
+ * each with its own stream.
+ *
+ * A flush can leave a worker's stream in the middle of an utterance, fed
+ * incrementally; the worker throws it away before its next job. */
+static gpointer
+gst_deepspeech_worker (gpointer data)
+{
+  GstDeepSpeechChannel *channel = (GstDeepSpeechChannel *) data;
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  StreamingState *stream = NULL, *stale;
+  GstDeepSpeechDecode *decode;
+  gboolean ends_segment;
+  guint epoch;
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  epoch = deepspeech->epoch;
+  while (TRUE) {
+    while (!deepspeech->worker_stop && gst_queue_array_is_empty (channel->pending))
+      g_cond_wait (&deepspeech->queue_cond, &deepspeech->queue_lock);
+    if (deepspeech->worker_stop)
+      break;
+
+    stale = NULL;
+    if (epoch != deepspeech->epoch) {
+      epoch = deepspeech->epoch;
+      stale = stream;
+      stream = NULL;
+      channel->interim_samples = 0;
+      g_clear_pointer (&channel->last_interim, g_free);
+      channel->late_segment = FALSE;
+      channel->feed_time = 0;
+    }
+
+    decode = g_new0 (GstDeepSpeechDecode, 1);
+    decode->epoch = epoch;
+    decode->job = *(GstDeepSpeechJob *) gst_queue_array_pop_head_struct (channel->pending);
+    ends_segment = GST_DEEPSPEECH_JOB_ENDS_SEGMENT (&decode->job);
+    if (ends_segment && !decode->job.dropped)
+      channel->pending_segments--;
+    channel->feeding = !ends_segment;
+    /* the range stays in place until the job is done with it */
+    gst_deepspeech_ring_peek_range (&channel->audio, decode->job.offset,
+        decode->job.n_samples, &decode->spans.data[0], &decode->spans.len[0],
+        &decode->spans.data[1], &decode->spans.len[1]);
+    g_queue_push_tail (&channel->decoding, decode);
+    g_cond_broadcast (&deepspeech->queue_cond);
+    g_mutex_unlock (&deepspeech->queue_lock);
+
+    if (stale) {
+      GST_DEBUG_OBJECT (deepspeech, "Discarding the stream of a flushed utterance");
+      gst_deepspeech_model_lock (deepspeech->model);
+      DS_FreeStream (stale);
+      gst_deepspeech_model_unlock (deepspeech->model);
+    }
+    process_job (channel, &stream, decode);
+
+    g_mutex_lock (&deepspeech->queue_lock);
+    decode->done = TRUE;
+    gst_deepspeech_release_audio (channel);
+    gst_deepspeech_post_results (channel);
+
+    if (ends_segment) {
+      /* off the critical path, once the result has been posted */
+      g_mutex_unlock (&deepspeech->queue_lock);
+      g_mutex_lock (&deepspeech->stream_lock);
+      gst_deepspeech_refill_streams (deepspeech);
+      g_mutex_unlock (&deepspeech->stream_lock);
+      gst_deepspeech_maybe_post_stats (deepspeech);
+      g_mutex_lock (&deepspeech->queue_lock);
+    }
+  }
+  g_mutex_unlock (&deepspeech->queue_lock);
+
+  if (stream)
+    DS_FreeStream (stream);
+
+  return NULL;
+}
+
+static void
+gst_deepspeech_channel_init (GstDeepSpeech * deepspeech,
+    GstDeepSpeechChannel * channel, guint index, guint n_workers)
+{
+  channel->deepspeech = deepspeech;
+  channel->index = index;
+  channel->segment_offset = GST_DEEPSPEECH_NO_OFFSET;
+  channel->segment_pts = GST_CLOCK_TIME_NONE;
+  channel->workers = g_new0 (GThread *, n_workers);
+  channel->n_workers = n_workers;
+  channel->pending = gst_queue_array_new_for_struct (sizeof (GstDeepSpeechJob),
+      PENDING_JOBS_SIZE);
+  g_queue_init (&channel->decoding);
+}
+
+/* The channel's workers must have been stopped. */
+static void
+gst_deepspeech_channel_clear (GstDeepSpeechChannel * channel)
+{
+  g_free (channel->workers);
+  gst_queue_array_free (channel->pending);
+  g_queue_foreach (&channel->decoding, (GFunc) gst_deepspeech_decode_free, NULL);
+  g_queue_clear (&channel->decoding);
+  g_free (channel->last_interim);
+  if (channel->vad)
+    gst_deepspeech_vad_free (channel->vad);
+  gst_deepspeech_ring_free (&channel->preroll);
+  gst_deepspeech_ring_free (&channel->audio);
+}
+
+/* Number of workers each channel gets in the current mode. */
+static guint
+gst_deepspeech_n_workers (GstDeepSpeech * deepspeech)
+{
+  if (deepspeech->mode != GST_DEEPSPEECH_MODE_OFFLINE)
+    return 1;
+  return deepspeech->decoders > 0 ? deepspeech->decoders : g_get_num_processors ();
+}
+
+/* Sets up n_channels channels and starts their workers, as many per
+ * channel as the mode calls for. Their streams come from the spare pool
+ * once they have audio to decode. */
+static gboolean
+gst_deepspeech_start_worker (GstDeepSpeech * deepspeech, guint n_channels)
+{
+  GError *error = NULL;
+  guint n_workers = gst_deepspeech_n_workers (deepspeech);
+  guint i, j;
+
+  deepspeech->worker_stop = FALSE;
+  deepspeech->offline = deepspeech->mode == GST_DEEPSPEECH_MODE_OFFLINE;
+  deepspeech->channels = g_new0 (GstDeepSpeechChannel, n_channels);
+  deepspeech->n_channels = n_channels;
+  for (i = 0; i < n_channels; i++)
+    gst_deepspeech_channel_init (deepspeech, &deepspeech->channels[i], i,
+        n_workers);
+
+  if (deepspeech->offline && deepspeech->model && !deepspeech->model->reentrant)
+    GST_INFO_OBJECT (deepspeech, "Inference with %s is serialized, segments "
+        "will mostly be decoded one at a time", deepspeech->speech_model_path);
+  GST_DEBUG_OBJECT (deepspeech, "Starting %u workers for each of %u channels",
+      n_workers, n_channels);
+
+  for (i = 0; i < n_channels; i++) {
+    GstDeepSpeechChannel *channel = &deepspeech->channels[i];
+
+    for (j = 0; j < n_workers; j++) {
+      channel->workers[j] = g_thread_try_new ("deepspeech",
+          gst_deepspeech_worker, channel, &error);
+      if (channel->workers[j] == NULL) {
+        GST_ELEMENT_ERROR (deepspeech, RESOURCE, FAILED,
+            ("Could not start worker thread."), ("%s", error->message));
+        g_error_free (error);
+        gst_deepspeech_stop_worker (deepspeech);
+        return FALSE;
+      }
+    }
+  }
+  return TRUE;
+}
+
+/* Stops the workers once they have finished the segments they are decoding,
+ * discarding anything still queued along with the audio it refers to. */
+static void
+gst_deepspeech_stop_worker (GstDeepSpeech * deepspeech)
+{
+  guint i, j;
+
+  if (deepspeech->channels == NULL)
+    return;
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  deepspeech->worker_stop = TRUE;
+  g_cond_broadcast (&deepspeech->queue_cond);
+  g_mutex_unlock (&deepspeech->queue_lock);
+
+  for (i = 0; i < deepspeech->n_channels; i++) {
+    GstDeepSpeechChannel *channel = &deepspeech->channels[i];
+
+    for (j = 0; j < channel->n_workers; j++) {
+      if (channel->workers[j])
+        g_thread_join (channel->workers[j]);
+    }
+  }
+  for (i = 0; i < deepspeech->n_channels; i++)
+    gst_deepspeech_channel_clear (&deepspeech->channels[i]);
+
+  g_free (deepspeech->channels);
+  deepspeech->channels = NULL;
+  deepspeech->n_channels = 0;
+}
+
+/* Blocks until every queued segment of every channel has been decoded and
+ * its result posted. Returns FALSE if the element started flushing in the
+ * meantime. */
+static gboolean
+gst_deepspeech_drain (GstDeepSpeech * deepspeech)
+{
+  gboolean ret;
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  while (!deepspeech->flushing && !gst_deepspeech_is_idle (deepspeech))
+    g_cond_wait (&deepspeech->queue_cond, &deepspeech->queue_lock);
+  ret = !deepspeech->flushing;
+  g_mutex_unlock (&deepspeech->queue_lock);
+
+  return ret;
+}
+
+/* Drops the queued jobs making up the oldest complete segment and returns
+ * its duration. If the worker has already fed the start of it into its
+ * stream, its ending job is turned into a discard job instead, so that the
+ * stream is thrown away rather than fed the next utterance. Such a discard
+ * job left at the head by an earlier drop is merged into the next segment's
+ * ending job the same way. */
+static GstClockTime
+gst_deepspeech_drop_oldest_segment (GstDeepSpeechChannel * channel)
+{
+  GstDeepSpeechJob *job;
+  gboolean feeding = channel->feeding;
+  GstClockTime duration;
+
+  job = (GstDeepSpeechJob *) gst_queue_array_peek_head_struct (channel->pending);
+  if (job->dropped) {
+    gst_queue_array_pop_head_struct (channel->pending);
+    feeding = TRUE;
+  }
+
+  while ((job = (GstDeepSpeechJob *) gst_queue_array_peek_head_struct (channel->pending)) &&
+      !GST_DEEPSPEECH_JOB_ENDS_SEGMENT (job))
+    gst_queue_array_pop_head_struct (channel->pending);
+  channel->pending_segments--;
+  duration = job->timing.duration;
+
+  if (feeding && job->type != GST_DEEPSPEECH_JOB_SEGMENT) {
+    job->type = GST_DEEPSPEECH_JOB_DISCARD;
+    job->n_samples = 0;
+    job->dropped = TRUE;
+  } else {
+    gst_queue_array_pop_head_struct (channel->pending);
+  }
+
+  return duration;
+}
+
+/* Drops the queued audio of the segment that is still being accumulated.
+ * The complete segments queued ahead of it keep the worker from having
+ * started on it. */
+static void
+gst_deepspeech_drop_newest_segment (GstDeepSpeechChannel * channel)
+{
+  GstDeepSpeechJob *job;
+
+  while ((job = (GstDeepSpeechJob *) gst_queue_array_peek_tail_struct (channel->pending)) &&
+      !GST_DEEPSPEECH_JOB_ENDS_SEGMENT (job))
+    gst_queue_array_pop_tail_struct (channel->pending);
+}
+
+/* Hands n_samples of ring audio starting at offset over to the channel's
+ * worker. Once max-pending-segments complete segments are already waiting,
+ * the configured backpressure policy is applied to jobs that would complete
+ * another one.
+ *
+ * A segment job also unpins the segment being accumulated, since from then
+ * on the job keeps its audio in the ring, or nothing does if it is
+ * dropped. */
+static GstFlowReturn
+gst_deepspeech_queue_job (GstDeepSpeechChannel * channel, GstDeepSpeechJobType type,
+    guint64 offset, gsize n_samples, GstClockTime timestamp, GstClockTime duration)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  GstDeepSpeechJob job;
+  GstDeepSpeechBackpressure backpressure;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstClockTime trace = GST_DEEPSPEECH_TRACE_START ();
+
+  /* nothing is dropped from a file */
+  backpressure = deepspeech->offline ? GST_DEEPSPEECH_BACKPRESSURE_BLOCK :
+      deepspeech->backpressure;
+
+  job.type = type;
+  job.offset = offset;
+  job.n_samples = n_samples;
+  gst_deepspeech_get_timing (deepspeech, timestamp, duration, &job.timing);
+  job.queued = g_get_monotonic_time ();
+  job.dropped = FALSE;
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  while (GST_DEEPSPEECH_JOB_ENDS_SEGMENT (&job) && !deepspeech->flushing &&
+      deepspeech->max_pending_segments > 0 &&
+      channel->pending_segments >= deepspeech->max_pending_segments) {
+    switch (backpressure) {
+      case GST_DEEPSPEECH_BACKPRESSURE_BLOCK:
+        g_cond_wait (&deepspeech->queue_cond, &deepspeech->queue_lock);
+        break;
+      case GST_DEEPSPEECH_BACKPRESSURE_DROP_OLDEST:
+        GST_DEBUG_OBJECT (deepspeech, "Queue full, dropping oldest segment");
+        deepspeech->dropped_duration += gst_deepspeech_drop_oldest_segment (channel);
+        deepspeech->dropped_segments++;
+        break;
+      case GST_DEEPSPEECH_BACKPRESSURE_DROP_NEWEST:
+        GST_DEBUG_OBJECT (deepspeech, "Queue full, dropping new segment");
+        gst_deepspeech_drop_newest_segment (channel);
+        deepspeech->dropped_segments++;
+        deepspeech->dropped_duration += job.timing.duration;
+        goto done;
+    }
+  }
+
+  if (deepspeech->flushing) {
+    ret = GST_FLOW_FLUSHING;
+    goto done;
+  }
+
+  gst_queue_array_push_tail_struct (channel->pending, &job);
+  if (GST_DEEPSPEECH_JOB_ENDS_SEGMENT (&job)) {
+    channel->pending_segments++;
+    deepspeech->max_queue_depth = MAX (deepspeech->max_queue_depth,
+        gst_deepspeech_queue_depth (deepspeech));
+  }
+
+done:
+  /* the job, or its pending-queue neighbours, now keep the audio */
+  if (GST_DEEPSPEECH_JOB_ENDS_SEGMENT (&job))
+    channel->segment_offset = GST_DEEPSPEECH_NO_OFFSET;
+  else
+    channel->segment_offset = offset + n_samples;
+  gst_deepspeech_release_audio (channel);
+  g_mutex_unlock (&deepspeech->queue_lock);
+
+  /* includes any time spent waiting for queue space */
+  GST_DEEPSPEECH_TRACE (GST_DEEPSPEECH_TRACE_HANDOFF, deepspeech, channel->index,
+      trace, n_samples);
+
+  return ret;
+}
+
+/* Copies audio for the current segment into the ring. If the ring is full
+ * the streaming thread waits for the worker to release space, whatever the
+ * backpressure policy; the ring is sized so that this only happens once
+ * several segments' worth of audio is waiting to be decoded. */
+static GstFlowReturn
+gst_deepspeech_write_audio (GstDeepSpeechChannel * channel, const gint16 * samples,
+    gsize n_samples)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  gsize written;
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  while (n_samples > 0) {
+    while (!deepspeech->flushing && gst_deepspeech_ring_space (&channel->audio) == 0)
+      g_cond_wait (&deepspeech->queue_cond, &deepspeech->queue_lock);
+    if (deepspeech->flushing) {
+      g_mutex_unlock (&deepspeech->queue_lock);
+      return GST_FLOW_FLUSHING;
+    }
+
+    written = gst_deepspeech_ring_append (&channel->audio, samples, n_samples);
+    deepspeech->copied += written * sizeof (gint16);
+    samples += written;
+    n_samples -= written;
+  }
+  g_mutex_unlock (&deepspeech->queue_lock);
+
+  return GST_FLOW_OK;
+}
+
+static void
+gst_deepspeech_set_flushing (GstDeepSpeech * deepspeech, gboolean flushing)
+{
+  g_mutex_lock (&deepspeech->queue_lock);
+  deepspeech->flushing = flushing;
+  g_cond_broadcast (&deepspeech->queue_cond);
+  g_mutex_unlock (&deepspeech->queue_lock);
+}
+
+/* GObject vmethod implementations */
+
+/* initialize the deepspeech's class */
+static void
+gst_deepspeech_class_init (GstDeepSpeechClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *gstelement_class;
+  GstBaseTransformClass *gstbasetransform_class;
+
+  gobject_class = (GObjectClass *) klass;
+  gstelement_class = (GstElementClass *) klass;
+  gstbasetransform_class = (GstBaseTransformClass *) klass;
+
+  gobject_class->set_property = gst_deepspeech_set_property;
+  gobject_class->get_property = gst_deepspeech_get_property;
+  gobject_class->finalize = gst_deepspeech_finalize;
+
+  gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_deepspeech_change_state);
+  gstelement_class->request_new_pad = GST_DEBUG_FUNCPTR (gst_deepspeech_request_new_pad);
+  gstelement_class->release_pad = GST_DEBUG_FUNCPTR (gst_deepspeech_release_pad);
+
+  gstbasetransform_class->set_caps = GST_DEBUG_FUNCPTR (gst_deepspeech_set_caps);
+  gstbasetransform_class->sink_event = GST_DEBUG_FUNCPTR (gst_deepspeech_sink_event);
+  gstbasetransform_class->transform_ip = GST_DEBUG_FUNCPTR (gst_deepspeech_transform_ip);
+
+  g_object_class_install_property (gobject_class, PROP_SPEECH_MODEL,
+      g_param_spec_string ("speech-model", "Speech Model", GST_DEEPSPEECH_SPEECH_MODEL_BLURB,
+          DEFAULT_SPEECH_MODEL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SCORER,
+      g_param_spec_string ("scorer", "Scorer", "Location of the scorer file. Changes apply from the next utterance, without reloading the speech model, unless the model is shared with other elements; those only share a model when they use the same scorer.",
+          DEFAULT_SCORER, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_BEAM_WIDTH,
+      g_param_spec_int ("beam-width", "Beam Width", GST_DEEPSPEECH_BEAM_WIDTH_BLURB " Changes apply from the next utterance.",
+          0, G_MAXINT, DEFAULT_BEAM_WIDTH, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_ADAPTIVE_BEAM,
+      g_param_spec_boolean ("adaptive-beam", "Adaptive Beam", "Narrow the beam while segments are waiting to be decoded, trading accuracy for keeping up with the input.",
+          DEFAULT_ADAPTIVE_BEAM, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MIN_BEAM_WIDTH,
+      g_param_spec_int ("min-beam-width", "Min Beam Width", "The narrowest beam adaptive-beam falls back to.",
+          1, G_MAXINT, DEFAULT_MIN_BEAM_WIDTH, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_LM_ALPHA,
+      g_param_spec_double ("lm-alpha", "LM Alpha", "The language model weight of the scorer. Unless set, the scorer's own weight is used. Shared by every element using the same model and scorer, and applied immediately.",
+          0.0, G_MAXFLOAT, DEFAULT_LM_ALPHA, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_LM_BETA,
+      g_param_spec_double ("lm-beta", "LM Beta", "The word insertion bonus of the scorer. Unless set, the scorer's own bonus is used. Shared by every element using the same model and scorer, and applied immediately.",
+          0.0, G_MAXFLOAT, DEFAULT_LM_BETA, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SILENCE_THRESHOLD,
+      g_param_spec_double ("silence-threshold", "Silence Threshold", GST_DEEPSPEECH_SILENCE_THRESHOLD_BLURB ("the specified silence length"),
+          0, 1.0, DEFAULT_SILENCE_THRESHOLD, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SILENCE_LENGTH,
+      g_param_spec_int ("silence-length", "Silence Length", "Number of buffers which must be below the silence threshold before segmentation occurs.",
+          0, G_MAXINT, DEFAULT_SILENCE_LENGTH, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MAX_PENDING_SEGMENTS,
+      g_param_spec_uint ("max-pending-segments", "Max Pending Segments", "Maximum number of segments waiting to be decoded, per channel, before backpressure is applied (0 = unlimited).",
+          0, G_MAXUINT, DEFAULT_MAX_PENDING_SEGMENTS, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_BACKPRESSURE,
+      g_param_spec_enum ("backpressure", "Backpressure", "What to do with new segments once max-pending-segments are waiting to be decoded.",
+          GST_TYPE_DEEPSPEECH_BACKPRESSURE, DEFAULT_BACKPRESSURE, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_FEED_MODE,
+      g_param_spec_enum ("feed-mode", "Feed Mode", "When audio is passed to the model.",
+          GST_TYPE_DEEPSPEECH_FEED_MODE, DEFAULT_FEED_MODE,
+          (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY)));
+  g_object_class_install_property (gobject_class, PROP_INTERIM_RESULTS_INTERVAL,
+      g_param_spec_uint64 ("interim-results-interval", "Interim Results Interval", "Amount of audio (in nanoseconds) between partial results in incremental feed mode (0 = disabled).",
+          0, G_MAXUINT64, DEFAULT_INTERIM_RESULTS_INTERVAL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SILENCE_DURATION,
+      g_param_spec_uint64 ("silence-duration", "Silence Duration", "Amount of audio (in nanoseconds) which must be below the silence threshold before segmentation occurs (0 = use silence-length).",
+          0, G_MAXUINT64, DEFAULT_SILENCE_DURATION, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MAX_SEGMENT_DURATION,
+      g_param_spec_uint64 ("max-segment-duration", "Max Segment Duration", "Force segmentation once a segment holds this much audio (in nanoseconds), even without silence. Also sizes the preallocated sample ring, which holds three such segments, and one more per additional decoder in offline mode.",
+          GST_SECOND, MAX_MAX_SEGMENT_DURATION, DEFAULT_MAX_SEGMENT_DURATION, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_VAD,
+      g_param_spec_enum ("vad", "Voice Activity Detector", GST_DEEPSPEECH_VAD_BLURB,
+          GST_TYPE_DEEPSPEECH_VAD_TYPE, DEFAULT_VAD, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_PRE_ROLL_DURATION,
+      g_param_spec_uint64 ("pre-roll-duration", "Pre-roll Duration", GST_DEEPSPEECH_PRE_ROLL_DURATION_BLURB,
+          0, G_MAXUINT64, DEFAULT_PRE_ROLL_DURATION, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MIN_SPEECH_RATIO,
+      g_param_spec_double ("min-speech-ratio", "Minimum Speech Ratio", "Segments in which less than this fraction of the audio was detected as speech are skipped without inference.",
+          0, 1.0, DEFAULT_MIN_SPEECH_RATIO, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MIN_SEGMENT_ENERGY,
+      g_param_spec_double ("min-segment-energy", "Minimum Segment Energy", "Segments whose speech has a lower mean square level (relative to full scale) are skipped without inference.",
+          0, 1.0, DEFAULT_MIN_SEGMENT_ENERGY, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SKIPPED_SEGMENTS,
+      g_param_spec_uint64 ("skipped-segments", "Skipped Segments", "Number of segments skipped as non-speech since the element last started or was flushed.",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE));
+  g_object_class_install_property (gobject_class, PROP_SKIPPED_DURATION,
+      g_param_spec_uint64 ("skipped-duration", "Skipped Duration", "Amount of audio (in nanoseconds) in segments skipped as non-speech since the element last started or was flushed.",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_class, PROP_POST_MESSAGES,
+      g_param_spec_boolean ("post-messages", "Post Messages", "Post results on the bus. Results are pushed from the text_src pad either way.",
+          DEFAULT_POST_MESSAGES, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_METADATA,
+      g_param_spec_boolean ("metadata", "Metadata", "Report candidate transcripts with their confidence and word timings along with the text.",
+          DEFAULT_METADATA, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_CANDIDATES,
+      g_param_spec_uint ("candidates", "Candidates", "Number of candidate transcripts to report when metadata is enabled.",
+          1, MAX_CANDIDATES, DEFAULT_CANDIDATES, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SPLIT_CHANNELS,
+      g_param_spec_boolean ("split-channels", "Split Channels", "Transcribe each input channel separately, such as one speaker per channel, instead of mixing them down. Applies from the next caps.",
+          DEFAULT_SPLIT_CHANNELS, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode", "How segments are scheduled. Offline mode decodes several segments of each channel at once and posts their results in order; it always feeds whole segments and blocks instead of dropping any. Applies from the next caps.",
+          GST_TYPE_DEEPSPEECH_MODE, DEFAULT_MODE,
+          (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY)));
+  g_object_class_install_property (gobject_class, PROP_DECODERS,
+      g_param_spec_uint ("decoders", "Decoders", "Number of segments of each channel decoded at once in offline mode (0 = one per CPU core).",
+          0, MAX_DECODERS, DEFAULT_DECODERS,
+          (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY)));
+  g_object_class_install_property (gobject_class, PROP_PRELOAD,
+      g_param_spec_enum ("preload", "Preload", "Whether to warm the model up when it is loaded, so that the first utterance doesn't wait for the model to initialize. Only the first element loading a model warms it up. Applies when the model is loaded.",
+          GST_TYPE_DEEPSPEECH_PRELOAD, DEFAULT_PRELOAD, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MAX_LATENCY,
+      g_param_spec_uint64 ("max-latency", "Max Latency", "In live mode, drop segments undecoded once their audio ended more than this long (in nanoseconds) ago by the pipeline clock, and post a QoS message for each (0 = never).",
+          0, G_MAXUINT64, DEFAULT_MAX_LATENCY, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_DROPPED_SEGMENTS,
+      g_param_spec_uint64 ("dropped-segments", "Dropped Segments", "Number of segments dropped by backpressure or for being late.",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE));
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics", "Performance statistics since the element last started or was flushed: real-time factor, queue depth, latency histograms, time spent waiting for the model, bytes copied and segments dropped or skipped.",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE));
+  g_object_class_install_property (gobject_class, PROP_STATS_INTERVAL,
+      g_param_spec_uint64 ("stats-interval", "Statistics Interval", "Post the statistics in a \"deepspeech-stats\" element message at most this often (in nanoseconds, 0 = never).",
+          0, G_MAXUINT64, DEFAULT_STATS_INTERVAL, G_PARAM_READWRITE));
+
+  /**
+   * GstDeepSpeech::add-hot-word:
+   * @deepspeech: the deepspeech element
+   * @word: the word to boost
+   * @boost: how much more (or, if negative, less) likely the word becomes
+   *
+   * Adds or updates a hot word, from the next utterance. Needs a scorer.
+   */
+  gst_deepspeech_signals[SIGNAL_ADD_HOT_WORD] =
+      g_signal_new ("add-hot-word", G_TYPE_FROM_CLASS (klass),
+      (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION),
+      G_STRUCT_OFFSET (GstDeepSpeechClass, add_hot_word), NULL, NULL, NULL,
+      G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_FLOAT);
+  /**
+   * GstDeepSpeech::erase-hot-word:
+   * @deepspeech: the deepspeech element
+   * @word: the word to stop boosting
+   */
+  gst_deepspeech_signals[SIGNAL_ERASE_HOT_WORD] =
+      g_signal_new ("erase-hot-word", G_TYPE_FROM_CLASS (klass),
+      (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION),
+      G_STRUCT_OFFSET (GstDeepSpeechClass, erase_hot_word), NULL, NULL, NULL,
+      G_TYPE_NONE, 1, G_TYPE_STRING);
+  /**
+   * GstDeepSpeech::clear-hot-words:
+   * @deepspeech: the deepspeech element
+   */
+  gst_deepspeech_signals[SIGNAL_CLEAR_HOT_WORDS] =
+      g_signal_new ("clear-hot-words", G_TYPE_FROM_CLASS (klass),
+      (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION),
+      G_STRUCT_OFFSET (GstDeepSpeechClass, clear_hot_words), NULL, NULL, NULL,
+      G_TYPE_NONE, 0);
+
+  klass->add_hot_word = gst_deepspeech_add_hot_word;
+  klass->erase_hot_word = gst_deepspeech_erase_hot_word;
+  klass->clear_hot_words = gst_deepspeech_clear_hot_words;
+
+  gst_element_class_set_details_simple(gstelement_class,
+    "deepspeech",
+    "Filter/Audio",
+    "Performs speech recognition using the Mozilla DeepSpeech model",
+    "Mike Sheldon <elleo@gnu.org>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&src_factory));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&sink_factory));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&text_src_factory));
+}
+
+/* initialize the new element
+ * instantiate pads and add them to element
+ * set pad calback functions
+ * initialize instance structure
+ */
+static void
+gst_deepspeech_init (GstDeepSpeech * deepspeech)
+{
+  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (deepspeech);
+
+  /* the audio is only read, and goes out as it came in */
+  gst_base_transform_set_passthrough (trans, TRUE);
+  gst_base_transform_set_in_place (trans, TRUE);
+
+  deepspeech->sinkpad = GST_BASE_TRANSFORM_SINK_PAD (trans);
+  deepspeech->srcpad = GST_BASE_TRANSFORM_SRC_PAD (trans);
+  gst_pad_set_iterate_internal_links_function (deepspeech->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_deepspeech_iterate_internal_links));
+
+  deepspeech->speech_model_path = g_strdup (DEFAULT_SPEECH_MODEL);
+  deepspeech->scorer_path = g_strdup (DEFAULT_SCORER);
+  deepspeech->beam_width = DEFAULT_BEAM_WIDTH;
+  deepspeech->adaptive_beam = DEFAULT_ADAPTIVE_BEAM;
+  deepspeech->min_beam_width = DEFAULT_MIN_BEAM_WIDTH;
+  deepspeech->lm_alpha = DEFAULT_LM_ALPHA;
+  deepspeech->lm_beta = DEFAULT_LM_BETA;
+  deepspeech->silence_threshold = DEFAULT_SILENCE_THRESHOLD;
+  deepspeech->silence_length = DEFAULT_SILENCE_LENGTH;
+  deepspeech->silence_duration = DEFAULT_SILENCE_DURATION;
+  deepspeech->max_segment_duration = DEFAULT_MAX_SEGMENT_DURATION;
+  deepspeech->vad_type = DEFAULT_VAD;
+  deepspeech->pre_roll_duration = DEFAULT_PRE_ROLL_DURATION;
+  deepspeech->min_speech_ratio = DEFAULT_MIN_SPEECH_RATIO;
+  deepspeech->min_segment_energy = DEFAULT_MIN_SEGMENT_ENERGY;
+  deepspeech->max_pending_segments = DEFAULT_MAX_PENDING_SEGMENTS;
+  deepspeech->backpressure = DEFAULT_BACKPRESSURE;
+  deepspeech->feed_mode = DEFAULT_FEED_MODE;
+  deepspeech->interim_results_interval = DEFAULT_INTERIM_RESULTS_INTERVAL;
+  deepspeech->post_messages = DEFAULT_POST_MESSAGES;
+  deepspeech->metadata = DEFAULT_METADATA;
+  deepspeech->candidates = DEFAULT_CANDIDATES;
+  deepspeech->rate = DEFAULT_RATE;
+  deepspeech->split_channels = DEFAULT_SPLIT_CHANNELS;
+  deepspeech->mode = DEFAULT_MODE;
+  deepspeech->decoders = DEFAULT_DECODERS;
+  deepspeech->preload = DEFAULT_PRELOAD;
+  deepspeech->max_latency = DEFAULT_MAX_LATENCY;
+  deepspeech->text_earliest_time = GST_CLOCK_TIME_NONE;
+  deepspeech->text_proportion = 1.0;
+  deepspeech->stats_interval = DEFAULT_STATS_INTERVAL;
+  deepspeech->last_stats_time = g_get_monotonic_time ();
+  deepspeech->next_timestamp = GST_CLOCK_TIME_NONE;
+  g_mutex_init (&deepspeech->stream_lock);
+  g_mutex_init (&deepspeech->queue_lock);
+  g_cond_init (&deepspeech->queue_cond);
+  g_mutex_init (&deepspeech->text_lock);
+  g_mutex_init (&deepspeech->stats_lock);
+  g_queue_init (&deepspeech->spare_streams);
+  deepspeech->hot_words = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, g_free);
+}
+
+/* The model is only loaded on the NULL to READY transition, once all the
+ * properties from the pipeline description have been applied. The scorer
+ * is loaded along with the model, and its weights are left as the
+ * scorer file sets them unless lm-alpha or lm-beta was set. With preload
+ * the first stream warms the model up, unless another element already
+ * has, and the pool is refilled after it. */
+static gboolean
+gst_deepspeech_load_model (GstDeepSpeech * deepspeech)
+{
+  GstDeepSpeechModel *model;
+  StreamingState *stream;
+
+  model = gst_deepspeech_model_acquire (deepspeech->speech_model_path,
+      deepspeech->scorer_path);
+  if (model == NULL) {
+    GST_ELEMENT_ERROR (deepspeech, RESOURCE, OPEN_READ,
+        ("Could not load model."),
+        ("speech-model=%s scorer=%s", deepspeech->speech_model_path,
+            deepspeech->scorer_path));
+    return FALSE;
+  }
+
+  /* everything downstream of the input conversion runs at this rate */
+  deepspeech->rate = DS_GetModelSampleRate (model->model_state);
+
+  g_mutex_lock (&deepspeech->stream_lock);
+  deepspeech->model = model;
+  deepspeech->spare_streams_stale = TRUE;
+  stream = gst_deepspeech_next_stream (deepspeech);
+  if (stream) {
+    gst_deepspeech_apply_lm_params (deepspeech);
+    /* the channels' workers take their streams from the pool */
+    if (deepspeech->preload == GST_DEEPSPEECH_PRELOAD_NONE ||
+        !gst_deepspeech_model_warm_up (model, stream,
+            deepspeech->preload == GST_DEEPSPEECH_PRELOAD_LOCK))
+      g_queue_push_head (&deepspeech->spare_streams, stream);
+    gst_deepspeech_refill_streams (deepspeech);
+  }
+  g_mutex_unlock (&deepspeech->stream_lock);
+
+  if (stream == NULL) {
+    GST_ELEMENT_ERROR (deepspeech, LIBRARY, INIT,
+        ("Could not create stream."),
+        ("scorer=%s", deepspeech->scorer_path));
+    gst_deepspeech_unload_model (deepspeech);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_deepspeech_unload_model (GstDeepSpeech * deepspeech)
+{
+  g_mutex_lock (&deepspeech->stream_lock);
+  gst_deepspeech_free_spare_streams (deepspeech);
+
+  if (deepspeech->model) {
+    gst_deepspeech_model_release (deepspeech->model);
+    deepspeech->model = NULL;
+  }
+  g_mutex_unlock (&deepspeech->stream_lock);
+}
+
+static void
+gst_deepspeech_finalize (GObject * object)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (object);
+
+  gst_deepspeech_stop_worker (deepspeech);
+  gst_deepspeech_unload_model (deepspeech);
+  if (deepspeech->pending_eos)
+    gst_event_unref (deepspeech->pending_eos);
+  g_hash_table_unref (deepspeech->hot_words);
+  if (deepspeech->convert)
+    gst_deepspeech_convert_free (deepspeech->convert);
+  g_mutex_clear (&deepspeech->stream_lock);
+  g_mutex_clear (&deepspeech->queue_lock);
+  g_cond_clear (&deepspeech->queue_cond);
+  g_mutex_clear (&deepspeech->text_lock);
+  g_mutex_clear (&deepspeech->stats_lock);
+  g_free (deepspeech->speech_model_path);
+  g_free (deepspeech->scorer_path);
+  g_free (deepspeech->planar);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static GstStateChangeReturn
+gst_deepspeech_change_state (GstElement * element, GstStateChange transition)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      gst_deepspeech_model_preload_from_env ();
+      if (!gst_deepspeech_load_model (deepspeech))
+        return GST_STATE_CHANGE_FAILURE;
+      if (!gst_deepspeech_start_worker (deepspeech, 1)) {
+        gst_deepspeech_unload_model (deepspeech);
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      break;
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_deepspeech_set_flushing (deepspeech, FALSE);
+      gst_deepspeech_reset_text_qos (deepspeech);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* Unblock the streaming thread if it is waiting for queue space */
+      gst_deepspeech_set_flushing (deepspeech, TRUE);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* ready to take a new stream from PAUSED, with the model loaded */
+      gst_deepspeech_reset_channels (deepspeech);
+      break;
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      gst_deepspeech_stop_worker (deepspeech);
+      gst_deepspeech_unload_model (deepspeech);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+static void
+gst_deepspeech_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (object);
+
+  switch (prop_id) {
+    case PROP_SPEECH_MODEL:
+      g_free (deepspeech->speech_model_path);
+      deepspeech->speech_model_path = g_value_dup_string (value);
+      break;
+    case PROP_SCORER:
+      gst_deepspeech_set_scorer (deepspeech, g_value_get_string (value));
+      break;
+    case PROP_BEAM_WIDTH:
+      g_mutex_lock (&deepspeech->stream_lock);
+      deepspeech->beam_width = g_value_get_int (value);
+      gst_deepspeech_renew_spare_streams (deepspeech);
+      g_mutex_unlock (&deepspeech->stream_lock);
+      break;
+    case PROP_ADAPTIVE_BEAM:
+      deepspeech->adaptive_beam = g_value_get_boolean (value);
+      break;
+    case PROP_MIN_BEAM_WIDTH:
+      deepspeech->min_beam_width = g_value_get_int (value);
+      break;
+    case PROP_LM_ALPHA:
+    case PROP_LM_BETA:
+      g_mutex_lock (&deepspeech->stream_lock);
+      if (prop_id == PROP_LM_ALPHA) {
+        deepspeech->lm_alpha = g_value_get_double (value);
+        deepspeech->lm_alpha_set = TRUE;
+      } else {
+        deepspeech->lm_beta = g_value_get_double (value);
+        deepspeech->lm_beta_set = TRUE;
+      }
+      gst_deepspeech_apply_lm_params (deepspeech);
+      g_mutex_unlock (&deepspeech->stream_lock);
+      break;
+    case PROP_SILENCE_THRESHOLD:
+      deepspeech->silence_threshold = g_value_get_double (value);
+      break;
+    case PROP_SILENCE_LENGTH:
+      deepspeech->silence_length = g_value_get_int (value);
+      break;
+    case PROP_MAX_PENDING_SEGMENTS:
+      g_mutex_lock (&deepspeech->queue_lock);
+      deepspeech->max_pending_segments = g_value_get_uint (value);
+      g_cond_broadcast (&deepspeech->queue_cond);
+      g_mutex_unlock (&deepspeech->queue_lock);
+      break;
+    case PROP_BACKPRESSURE:
+      g_mutex_lock (&deepspeech->queue_lock);
+      deepspeech->backpressure = (GstDeepSpeechBackpressure) g_value_get_enum (value);
+      g_cond_broadcast (&deepspeech->queue_cond);
+      g_mutex_unlock (&deepspeech->queue_lock);
+      break;
+    case PROP_FEED_MODE:
+      deepspeech->feed_mode = (GstDeepSpeechFeedMode) g_value_get_enum (value);
+      break;
+    case PROP_INTERIM_RESULTS_INTERVAL:
+      deepspeech->interim_results_interval = g_value_get_uint64 (value);
+      break;
+    case PROP_POST_MESSAGES:
+      deepspeech->post_messages = g_value_get_boolean (value);
+      break;
+    case PROP_METADATA:
+      deepspeech->metadata = g_value_get_boolean (value);
+      break;
+    case PROP_CANDIDATES:
+      deepspeech->candidates = g_value_get_uint (value);
+      break;
+    case PROP_SPLIT_CHANNELS:
+      deepspeech->split_channels = g_value_get_boolean (value);
+      break;
+    case PROP_MODE:
+      deepspeech->mode = (GstDeepSpeechMode) g_value_get_enum (value);
+      break;
+    case PROP_DECODERS:
+      deepspeech->decoders = g_value_get_uint (value);
+      break;
+    case PROP_PRELOAD:
+      deepspeech->preload = (GstDeepSpeechPreload) g_value_get_enum (value);
+      break;
+    case PROP_MAX_LATENCY:
+      deepspeech->max_latency = g_value_get_uint64 (value);
+      break;
+    case PROP_STATS_INTERVAL:
+      deepspeech->stats_interval = g_value_get_uint64 (value);
+      break;
+    case PROP_SILENCE_DURATION:
+      deepspeech->silence_duration = g_value_get_uint64 (value);
+      break;
+    case PROP_MAX_SEGMENT_DURATION:
+      deepspeech->max_segment_duration = g_value_get_uint64 (value);
+      break;
+    case PROP_VAD:
+      deepspeech->vad_type = (GstDeepSpeechVadType) g_value_get_enum (value);
+      break;
+    case PROP_PRE_ROLL_DURATION:
+      deepspeech->pre_roll_duration = g_value_get_uint64 (value);
+      break;
+    case PROP_MIN_SPEECH_RATIO:
+      deepspeech->min_speech_ratio = g_value_get_double (value);
+      break;
+    case PROP_MIN_SEGMENT_ENERGY:
+      deepspeech->min_segment_energy = g_value_get_double (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_deepspeech_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (object);
+
+  switch (prop_id) {
+    case PROP_SPEECH_MODEL:
+      g_value_set_string (value, deepspeech->speech_model_path);
+      break;
+    case PROP_SCORER:
+      g_value_set_string (value, deepspeech->scorer_path);
+      break;
+    case PROP_BEAM_WIDTH:
+      g_value_set_int (value, deepspeech->beam_width);
+      break;
+    case PROP_ADAPTIVE_BEAM:
+      g_value_set_boolean (value, deepspeech->adaptive_beam);
+      break;
+    case PROP_MIN_BEAM_WIDTH:
+      g_value_set_int (value, deepspeech->min_beam_width);
+      break;
+    case PROP_LM_ALPHA:
+    case PROP_LM_BETA:
+    {
+      gdouble weight;
+      gfloat alpha, beta;
+
+      /* report what the scorer uses unless this element set it */
+      g_mutex_lock (&deepspeech->stream_lock);
+      if (prop_id == PROP_LM_ALPHA)
+        weight = deepspeech->lm_alpha;
+      else
+        weight = deepspeech->lm_beta;
+      if (deepspeech->model && !(prop_id == PROP_LM_ALPHA ?
+              deepspeech->lm_alpha_set : deepspeech->lm_beta_set) &&
+          gst_deepspeech_model_get_alpha_beta (deepspeech->model, &alpha,
+              &beta))
+        weight = prop_id == PROP_LM_ALPHA ? alpha : beta;
+      g_mutex_unlock (&deepspeech->stream_lock);
+      g_value_set_double (value, weight);
+      break;
+    }
+    case PROP_SILENCE_THRESHOLD:
+      g_value_set_double (value, deepspeech->silence_threshold);
+      break;
+    case PROP_SILENCE_LENGTH:
+      g_value_set_int (value, deepspeech->silence_length);
+      break;
+    case PROP_MAX_PENDING_SEGMENTS:
+      g_value_set_uint (value, deepspeech->max_pending_segments);
+      break;
+    case PROP_BACKPRESSURE:
+      g_value_set_enum (value, deepspeech->backpressure);
+      break;
+    case PROP_FEED_MODE:
+      g_value_set_enum (value, deepspeech->feed_mode);
+      break;
+    case PROP_INTERIM_RESULTS_INTERVAL:
+      g_value_set_uint64 (value, deepspeech->interim_results_interval);
+      break;
+    case PROP_POST_MESSAGES:
+      g_value_set_boolean (value, deepspeech->post_messages);
+      break;
+    case PROP_METADATA:
+      g_value_set_boolean (value, deepspeech->metadata);
+      break;
+    case PROP_CANDIDATES:
+      g_value_set_uint (value, deepspeech->candidates);
+      break;
+    case PROP_SPLIT_CHANNELS:
+      g_value_set_boolean (value, deepspeech->split_channels);
+      break;
+    case PROP_MODE:
+      g_value_set_enum (value, deepspeech->mode);
+      break;
+    case PROP_DECODERS:
+      g_value_set_uint (value, deepspeech->decoders);
+      break;
+    case PROP_PRELOAD:
+      g_value_set_enum (value, deepspeech->preload);
+      break;
+    case PROP_MAX_LATENCY:
+      g_value_set_uint64 (value, deepspeech->max_latency);
+      break;
+    case PROP_DROPPED_SEGMENTS:
+      g_value_set_uint64 (value, deepspeech->dropped_segments);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_deepspeech_get_stats (deepspeech));
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint64 (value, deepspeech->stats_interval);
+      break;
+    case PROP_SILENCE_DURATION:
+      g_value_set_uint64 (value, deepspeech->silence_duration);
+      break;
+    case PROP_MAX_SEGMENT_DURATION:
+      g_value_set_uint64 (value, deepspeech->max_segment_duration);
+      break;
+    case PROP_VAD:
+      g_value_set_enum (value, deepspeech->vad_type);
+      break;
+    case PROP_PRE_ROLL_DURATION:
+      g_value_set_uint64 (value, deepspeech->pre_roll_duration);
+      break;
+    case PROP_MIN_SPEECH_RATIO:
+      g_value_set_double (value, deepspeech->min_speech_ratio);
+      break;
+    case PROP_MIN_SEGMENT_ENERGY:
+      g_value_set_double (value, deepspeech->min_segment_energy);
+      break;
+    case PROP_SKIPPED_SEGMENTS:
+      g_value_set_uint64 (value, deepspeech->skipped_segments);
+      break;
+    case PROP_SKIPPED_DURATION:
+      g_value_set_uint64 (value, deepspeech->skipped_duration);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+typedef struct
+{
+  GValue *words;
+  GstClockTime base;
+} GstDeepSpeechValueWords;
+
+static void
+gst_deepspeech_append_word_value (const gchar * word, GstClockTime start,
+    GstClockTime end, gpointer user_data)
+{
+  GstDeepSpeechValueWords *words = (GstDeepSpeechValueWords *) user_data;
+  GValue value = G_VALUE_INIT;
+
+  g_value_init (&value, GST_TYPE_STRUCTURE);
+  g_value_take_boxed (&value, gst_structure_new ("word",
+          "word", G_TYPE_STRING, word,
+          "timestamp", G_TYPE_UINT64,
+          GST_CLOCK_TIME_IS_VALID (words->base) ? words->base + start : GST_CLOCK_TIME_NONE,
+          "duration", G_TYPE_UINT64, end - start, NULL));
+  gst_value_array_append_and_take_value (words->words, &value);
+}
+
+/* Fills value with an array of "candidate" structures, best first, each
+ * holding the candidate's text, its confidence and an array of "word"
+ * structures with the timestamp and duration of every word. Word timestamps
+ * are relative to base, the start of the utterance. */
+static void
+gst_deepspeech_candidates_to_value (const Metadata * metadata, GstClockTime base,
+    GValue * value)
+{
+  guint i;
+
+  g_value_init (value, GST_TYPE_ARRAY);
+  for (i = 0; i < metadata->num_transcripts; i++) {
+    const CandidateTranscript *candidate = &metadata->transcripts[i];
+    GValue words = G_VALUE_INIT;
+    GValue entry = G_VALUE_INIT;
+    GstDeepSpeechValueWords ctx = { &words, base };
+    GstStructure *s;
+    gchar *text;
+
+    g_value_init (&words, GST_TYPE_ARRAY);
+    gst_deepspeech_foreach_word (candidate, gst_deepspeech_append_word_value, &ctx);
+
+    text = gst_deepspeech_candidate_text (candidate);
+    s = gst_structure_new ("candidate",
+        "text", G_TYPE_STRING, text,
+        "confidence", G_TYPE_DOUBLE, candidate->confidence, NULL);
+    gst_structure_take_value (s, "words", &words);
+    g_free (text);
+
+    g_value_init (&entry, GST_TYPE_STRUCTURE);
+    g_value_take_boxed (&entry, s);
+    gst_value_array_append_and_take_value (value, &entry);
+  }
+}
+
+static GstMessage *
+gst_deepspeech_message_new (GstDeepSpeech * deepspeech, guint channel, const GstDeepSpeechTiming * timing, const char * text, bool intermediate, const Metadata * metadata)
+{
+  GstStructure *s;
+
+  s = gst_structure_new ("deepspeech",
+      "timestamp", G_TYPE_UINT64, timing->timestamp,
+      "stream-time", G_TYPE_UINT64, timing->stream_time,
+      "running-time", G_TYPE_UINT64, timing->running_time,
+      "duration", G_TYPE_UINT64, timing->duration,
+      "end-stream-time", G_TYPE_UINT64, timing->end_stream_time,
+      "end-running-time", G_TYPE_UINT64, timing->end_running_time,
+      "intermediate", G_TYPE_BOOLEAN, intermediate,
+      "channel", G_TYPE_UINT, channel,
+      "text", G_TYPE_STRING, text, NULL);
+
+  if (metadata) {
+    GValue candidates = G_VALUE_INIT;
+
+    gst_deepspeech_candidates_to_value (metadata, timing->timestamp, &candidates);
+    gst_structure_take_value (s, "candidates", &candidates);
+  }
+
+  return gst_message_new_element (GST_OBJECT (deepspeech), s);
+}
+
+/* Audio events only go to the audio source pad; the text pad gets its own
+ * stream-start, caps and segment. */
+static GstIterator *
+gst_deepspeech_iterate_internal_links (GstPad * pad, GstObject * parent)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (parent);
+  GstIterator *it;
+  GValue val = G_VALUE_INIT;
+
+  g_value_init (&val, GST_TYPE_PAD);
+  g_value_set_object (&val, deepspeech->srcpad);
+  it = gst_iterator_new_single (GST_TYPE_PAD, &val);
+  g_value_unset (&val);
+
+  return it;
+}
+
+/* Keeps track of QoS events from the text pad's downstream, so that
+ * segments whose results would arrive too late are dropped. */
+static gboolean
+gst_deepspeech_text_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (parent);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_QOS:
+    {
+      GstQOSType type;
+      gdouble proportion;
+      GstClockTimeDiff diff;
+      GstClockTime timestamp;
+
+      gst_event_parse_qos (event, &type, &proportion, &diff, &timestamp);
+      GST_OBJECT_LOCK (deepspeech);
+      deepspeech->text_proportion = proportion;
+      if (GST_CLOCK_TIME_IS_VALID (timestamp) && diff > 0)
+        deepspeech->text_earliest_time = timestamp + diff;
+      else
+        deepspeech->text_earliest_time = GST_CLOCK_TIME_NONE;
+      GST_OBJECT_UNLOCK (deepspeech);
+      gst_event_unref (event);
+      return TRUE;
+    }
+    default:
+      return gst_pad_event_default (pad, parent, event);
+  }
+}
+
+/* Forgets what the text pad's downstream said about lateness. */
+static void
+gst_deepspeech_reset_text_qos (GstDeepSpeech * deepspeech)
+{
+  GST_OBJECT_LOCK (deepspeech);
+  deepspeech->text_earliest_time = GST_CLOCK_TIME_NONE;
+  deepspeech->text_proportion = 1.0;
+  GST_OBJECT_UNLOCK (deepspeech);
+}
+
+static GstPad *
+gst_deepspeech_request_new_pad (GstElement * element, GstPadTemplate * templ,
+    const gchar * name, const GstCaps * caps)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (element);
+  GstPad *pad;
+
+  GST_OBJECT_LOCK (deepspeech);
+  if (deepspeech->textpad) {
+    GST_OBJECT_UNLOCK (deepspeech);
+    GST_WARNING_OBJECT (deepspeech, "There already is a text_src pad");
+    return NULL;
+  }
+  GST_OBJECT_UNLOCK (deepspeech);
+
+  pad = gst_pad_new_from_template (templ, "text_src");
+  gst_pad_use_fixed_caps (pad);
+  gst_pad_set_event_function (pad, gst_deepspeech_text_event);
+  gst_pad_set_active (pad, TRUE);
+  if (!gst_element_add_pad (element, pad)) {
+    gst_object_unref (pad);
+    return NULL;
+  }
+
+  GST_OBJECT_LOCK (deepspeech);
+  deepspeech->textpad = pad;
+  deepspeech->text_need_caps = TRUE;
+  deepspeech->text_need_segment = TRUE;
+  GST_OBJECT_UNLOCK (deepspeech);
+
+  return pad;
+}
+
+static void
+gst_deepspeech_release_pad (GstElement * element, GstPad * pad)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (element);
+
+  GST_OBJECT_LOCK (deepspeech);
+  if (deepspeech->textpad == pad)
+    deepspeech->textpad = NULL;
+  GST_OBJECT_UNLOCK (deepspeech);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+}
+
+/* Returns a reference to the text pad, or NULL if nobody asked for one. */
+static GstPad *
+gst_deepspeech_get_text_pad (GstDeepSpeech * deepspeech)
+{
+  GstPad *pad = NULL;
+
+  GST_OBJECT_LOCK (deepspeech);
+  if (deepspeech->textpad)
+    pad = GST_PAD_CAST (gst_object_ref (deepspeech->textpad));
+  GST_OBJECT_UNLOCK (deepspeech);
+
+  return pad;
+}
+
+/* Sends an event from the text pad, if there is one. Takes ownership of the
+ * event. */
+static void
+gst_deepspeech_push_text_event (GstDeepSpeech * deepspeech, GstEvent * event)
+{
+  GstPad *pad = gst_deepspeech_get_text_pad (deepspeech);
+
+  if (pad == NULL) {
+    gst_event_unref (event);
+    return;
+  }
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP)
+    deepspeech->text_need_segment = TRUE;
+  gst_pad_push_event (pad, event);
+  gst_object_unref (pad);
+}
+
+/* Picks plain text or JSON, whichever downstream prefers, and announces it
+ * along with the stream. Returns FALSE if the pad isn't linked yet or
+ * downstream accepts neither. */
+static gboolean
+gst_deepspeech_negotiate_text (GstDeepSpeech * deepspeech, GstPad * pad)
+{
+  GstCaps *templ, *caps;
+  gchar *stream_id;
+
+  if (!gst_pad_is_linked (pad))
+    return FALSE;
+
+  templ = gst_pad_get_pad_template_caps (pad);
+  caps = gst_pad_peer_query_caps (pad, templ);
+  gst_caps_unref (templ);
+  if (gst_caps_is_empty (caps)) {
+    gst_caps_unref (caps);
+    return FALSE;
+  }
+  caps = gst_caps_fixate (caps);
+  deepspeech->text_json = gst_structure_has_name (gst_caps_get_structure (caps, 0),
+      "application/json");
+
+  stream_id = gst_pad_create_stream_id (pad, GST_ELEMENT (deepspeech), "text");
+  gst_pad_push_event (pad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+  gst_pad_push_event (pad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+
+  deepspeech->text_need_caps = FALSE;
+  return TRUE;
+}
+
+static void
+gst_deepspeech_json_append_string (GString * json, const char * text)
+{
+  const char *p;
+
+  g_string_append_c (json, '"');
+  for (p = text; *p; p++) {
+    switch (*p) {
+      case '"':
+        g_string_append (json, "\\\"");
+        break;
+      case '\\':
+        g_string_append (json, "\\\\");
+        break;
+      case '\n':
+        g_string_append (json, "\\n");
+        break;
+      default:
+        if ((guchar) *p < 0x20)
+          g_string_append_printf (json, "\\u%04x", (guchar) *p);
+        else
+          g_string_append_c (json, *p);
+        break;
+    }
+  }
+  g_string_append_c (json, '"');
+}
+
+typedef struct
+{
+  GString *json;
+  GstClockTime base;
+  gboolean first;
+} GstDeepSpeechJsonWords;
+
+static void
+gst_deepspeech_json_append_word (const gchar * word, GstClockTime start,
+    GstClockTime end, gpointer user_data)
+{
+  GstDeepSpeechJsonWords *words = (GstDeepSpeechJsonWords *) user_data;
+
+  if (!words->first)
+    g_string_append_c (words->json, ',');
+  words->first = FALSE;
+  g_string_append (words->json, "{\"word\":");
+  gst_deepspeech_json_append_string (words->json, word);
+  g_string_append_printf (words->json, ",\"timestamp\":%" G_GUINT64_FORMAT
+      ",\"duration\":%" G_GUINT64_FORMAT "}",
+      GST_CLOCK_TIME_IS_VALID (words->base) ? words->base + start : GST_CLOCK_TIME_NONE,
+      end - start);
+}
+
+/* Appends the candidates as a "candidates" member, laid out like the
+ * candidates field of the element message. */
+static void
+gst_deepspeech_json_append_candidates (GString * json, const Metadata * metadata,
+    GstClockTime base)
+{
+  gchar confidence[G_ASCII_DTOSTR_BUF_SIZE];
+  guint i;
+
+  g_string_append (json, ",\"candidates\":[");
+  for (i = 0; i < metadata->num_transcripts; i++) {
+    const CandidateTranscript *candidate = &metadata->transcripts[i];
+    GstDeepSpeechJsonWords words = { json, base, TRUE };
+    gchar *text = gst_deepspeech_candidate_text (candidate);
+
+    if (i > 0)
+      g_string_append_c (json, ',');
+    g_string_append (json, "{\"text\":");
+    gst_deepspeech_json_append_string (json, text);
+    g_ascii_dtostr (confidence, sizeof (confidence), candidate->confidence);
+    g_string_append_printf (json, ",\"confidence\":%s,\"words\":[", confidence);
+    gst_deepspeech_foreach_word (candidate, gst_deepspeech_json_append_word, &words);
+    g_string_append (json, "]}");
+    g_free (text);
+  }
+  g_string_append_c (json, ']');
+}
+
+/* Pushes a result from the text pad. This runs on the channel's worker
+ * thread, so downstream gets results as soon as they are decoded, without a
+ * detour through the bus and the main loop. The text lock keeps the workers
+ * of different channels from interleaving their pushes. */
+static void
+gst_deepspeech_push_text (GstDeepSpeech * deepspeech, guint channel, const char * text,
+    const GstDeepSpeechTiming * timing, gboolean intermediate,
+    const Metadata * metadata)
+{
+  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (deepspeech);
+  GstPad *pad;
+  GstBuffer *buf;
+  GstFlowReturn ret;
+  gchar *data;
+  gsize size;
+
+  pad = gst_deepspeech_get_text_pad (deepspeech);
+  if (pad == NULL)
+    return;
+
+  g_mutex_lock (&deepspeech->text_lock);
+  if (deepspeech->text_need_caps && !gst_deepspeech_negotiate_text (deepspeech, pad)) {
+    g_mutex_unlock (&deepspeech->text_lock);
+    GST_DEBUG_OBJECT (pad, "Not negotiated, dropping result");
+    gst_object_unref (pad);
+    return;
+  }
+  if (deepspeech->text_need_segment) {
+    gst_pad_push_event (pad, gst_event_new_segment (&trans->segment));
+    deepspeech->text_need_segment = FALSE;
+  }
+
+  if (deepspeech->text_json) {
+    GString *json = g_string_new (NULL);
+
+    g_string_append_printf (json, "{\"timestamp\":%" G_GUINT64_FORMAT
+        ",\"stream-time\":%" G_GUINT64_FORMAT ",\"running-time\":%" G_GUINT64_FORMAT
+        ",\"duration\":%" G_GUINT64_FORMAT ",\"end-stream-time\":%" G_GUINT64_FORMAT
+        ",\"end-running-time\":%" G_GUINT64_FORMAT ",\"intermediate\":%s"
+        ",\"channel\":%u,\"text\":",
+        timing->timestamp, timing->stream_time, timing->running_time,
+        timing->duration, timing->end_stream_time, timing->end_running_time,
+        intermediate ? "true" : "false", channel);
+    gst_deepspeech_json_append_string (json, text);
+    if (metadata)
+      gst_deepspeech_json_append_candidates (json, metadata, timing->timestamp);
+    g_string_append (json, "}\n");
+    size = json->len;
+    data = g_string_free (json, FALSE);
+  } else {
+    data = g_strdup (text);
+    size = strlen (data);
+  }
+
+  buf = gst_buffer_new_wrapped (data, size);
+  GST_BUFFER_PTS (buf) = timing->timestamp;
+  GST_BUFFER_DURATION (buf) = timing->duration;
+  if (intermediate)
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  ret = gst_pad_push (pad, buf);
+  g_mutex_unlock (&deepspeech->text_lock);
+  if (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED && ret != GST_FLOW_FLUSHING)
+    GST_WARNING_OBJECT (pad, "Pushing result failed: %s", gst_flow_get_name (ret));
+  gst_object_unref (pad);
+}
+
+/* GstBaseTransform vmethod implementations */
+
+static gboolean
+gst_deepspeech_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (trans);
+  GstDeepSpeechConvert *convert;
+  GstAudioInfo info;
+  guint n_channels;
+
+  if (!gst_audio_info_from_caps (&info, incaps)) {
+    GST_WARNING_OBJECT (deepspeech, "Invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+
+  n_channels = deepspeech->split_channels ? GST_AUDIO_INFO_CHANNELS (&info) : 1;
+  convert = gst_deepspeech_convert_new (&info, deepspeech->rate,
+      !deepspeech->split_channels);
+  if (convert == NULL) {
+    GST_WARNING_OBJECT (deepspeech, "Can't convert %" GST_PTR_FORMAT
+        " to %d Hz", incaps, deepspeech->rate);
+    return FALSE;
+  }
+  if (deepspeech->convert)
+    gst_deepspeech_convert_free (deepspeech->convert);
+  deepspeech->convert = convert;
+
+  /* each channel has its own workers, so a new channel count or mode means
+   * finishing what the current ones have and starting over */
+  if (n_channels != deepspeech->n_channels ||
+      (deepspeech->mode == GST_DEEPSPEECH_MODE_OFFLINE) != deepspeech->offline ||
+      gst_deepspeech_n_workers (deepspeech) != deepspeech->channels[0].n_workers) {
+    GST_DEBUG_OBJECT (deepspeech, "Transcribing %u channels", n_channels);
+    gst_deepspeech_end_segments (deepspeech);
+    gst_deepspeech_drain (deepspeech);
+    gst_deepspeech_stop_worker (deepspeech);
+    if (!gst_deepspeech_start_worker (deepspeech, n_channels))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* this function handles sink events; basetransform keeps track of the
+ * segment and forwards everything to the audio src pad */
+static gboolean
+gst_deepspeech_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (trans);
+
+  GST_LOG_OBJECT (deepspeech, "Received %s event: %" GST_PTR_FORMAT,
+      GST_EVENT_TYPE_NAME (event), event);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_SEGMENT:
+    {
+      const GstSegment *segment;
+
+      gst_event_parse_segment (event, &segment);
+      deepspeech->next_timestamp = segment->format == GST_FORMAT_TIME ?
+          segment->start : GST_CLOCK_TIME_NONE;
+      deepspeech->text_need_segment = TRUE;
+      break;
+    }
+    case GST_EVENT_STREAM_START:
+      /* without a flush in between, a new stream mustn't overtake the EOS
+       * of the previous one */
+      g_mutex_lock (&deepspeech->queue_lock);
+      while (!deepspeech->flushing &&
+          (deepspeech->pending_eos || deepspeech->forwarding_eos))
+        g_cond_wait (&deepspeech->queue_cond, &deepspeech->queue_lock);
+      g_mutex_unlock (&deepspeech->queue_lock);
+      break;
+    case GST_EVENT_FLUSH_START:
+      /* unblocks the streaming thread if it is waiting for queue space */
+      gst_deepspeech_set_flushing (deepspeech, TRUE);
+      gst_deepspeech_push_text_event (deepspeech, gst_event_ref (event));
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_deepspeech_reset_channels (deepspeech);
+      gst_deepspeech_reset_text_qos (deepspeech);
+      gst_deepspeech_set_flushing (deepspeech, FALSE);
+      gst_deepspeech_push_text_event (deepspeech, gst_event_ref (event));
+      break;
+    case GST_EVENT_EOS:
+    {
+      guint i;
+
+      gst_deepspeech_end_segments (deepspeech);
+      for (i = 0; i < deepspeech->n_channels; i++) {
+        GstDeepSpeechChannel *channel = &deepspeech->channels[i];
+
+        gst_deepspeech_ring_clear (&channel->preroll);
+        if (channel->vad)
+          gst_deepspeech_vad_reset (channel->vad);
+      }
+
+      /* the streaming thread doesn't wait for the backlog to be decoded;
+       * the worker posting the last result forwards the EOS instead */
+      g_mutex_lock (&deepspeech->queue_lock);
+      if (!deepspeech->flushing && !gst_deepspeech_is_idle (deepspeech)) {
+        GST_DEBUG_OBJECT (deepspeech, "Holding EOS back until decoding finishes");
+        deepspeech->pending_eos = event;
+        g_mutex_unlock (&deepspeech->queue_lock);
+        return TRUE;
+      }
+      g_mutex_unlock (&deepspeech->queue_lock);
+      gst_deepspeech_push_text_event (deepspeech, gst_event_new_eos ());
+      break;
+    }
+    default:
+      break;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+/* Makes sure the channel's voice activity detector and rings match the
+ * current properties and caps. The sample ring can only be resized while it
+ * is empty, so a new max-segment-duration or pre-roll-duration takes effect
+ * between utterances once the backlog has been decoded. */
+static void
+gst_deepspeech_prepare_segmenter (GstDeepSpeechChannel * channel)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  guint64 segment_samples, preroll_samples, capacity;
+
+  if (channel->vad == NULL || channel->vad->type != deepspeech->vad_type ||
+      channel->vad->rate != deepspeech->rate) {
+    if (channel->vad)
+      gst_deepspeech_vad_free (channel->vad);
+    channel->vad = gst_deepspeech_vad_new (deepspeech->vad_type, deepspeech->rate);
+  }
+  channel->vad->threshold = deepspeech->silence_threshold;
+
+  if (channel->in_speech)
+    return;
+
+  segment_samples = gst_deepspeech_duration_to_samples (deepspeech,
+      deepspeech->max_segment_duration);
+  preroll_samples = gst_deepspeech_duration_to_samples (deepspeech,
+      deepspeech->pre_roll_duration);
+  capacity = (AUDIO_RING_SEGMENTS + channel->n_workers - 1) *
+      (segment_samples + preroll_samples);
+  if (channel->audio.capacity == capacity &&
+      channel->preroll.capacity == preroll_samples)
+    return;
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  if (channel->audio.length == 0) {
+    GST_DEBUG_OBJECT (deepspeech, "Allocating %" G_GUINT64_FORMAT
+        " samples of segment audio for channel %u", capacity, channel->index);
+    gst_deepspeech_ring_init (&channel->audio, capacity);
+    gst_deepspeech_ring_init (&channel->preroll, preroll_samples);
+    channel->segment_limit = segment_samples;
+  }
+  g_mutex_unlock (&deepspeech->queue_lock);
+}
+
+/* Starts accumulating a segment at the ring's current end. Its timestamp is
+ * that of the pre-roll it will start with. */
+static void
+gst_deepspeech_begin_segment (GstDeepSpeechChannel * channel, GstClockTime timestamp)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  GstClockTime preroll_duration;
+
+  preroll_duration = gst_deepspeech_samples_to_duration (deepspeech,
+      channel->preroll.length);
+  if (GST_CLOCK_TIME_IS_VALID (timestamp))
+    timestamp = timestamp > preroll_duration ? timestamp - preroll_duration : 0;
+
+  channel->in_speech = TRUE;
+  channel->segment_pts = timestamp;
+
+  /* keeps audio written before its feed job is queued from being released
+   * by a worker in between */
+  g_mutex_lock (&deepspeech->queue_lock);
+  channel->segment_offset = channel->audio.end;
+  g_mutex_unlock (&deepspeech->queue_lock);
+}
+
+/* Adds audio to the current segment, feeding it straight to the worker in
+ * incremental mode. */
+static GstFlowReturn
+gst_deepspeech_add_to_segment (GstDeepSpeechChannel * channel, const gint16 * samples,
+    gsize n_samples)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  guint64 offset = channel->audio.end;
+  GstFlowReturn ret;
+
+  ret = gst_deepspeech_write_audio (channel, samples, n_samples);
+  if (ret != GST_FLOW_OK)
+    return ret;
+  channel->segment_samples += n_samples;
+
+  if (gst_deepspeech_feeds_incrementally (deepspeech))
+    return gst_deepspeech_queue_job (channel, GST_DEEPSPEECH_JOB_FEED, offset,
+        n_samples, channel->segment_pts, gst_deepspeech_samples_to_duration (
+            deepspeech, channel->segment_samples));
+  return GST_FLOW_OK;
+}
+
+/* Decides whether a finished segment is worth decoding at all. Segments that
+ * are mostly non-speech, such as noise bursts or hold music that tripped the
+ * detector, or whose energy is too low are skipped. */
+static gboolean
+gst_deepspeech_segment_is_speech (GstDeepSpeechChannel * channel)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  gdouble ratio, energy;
+
+  if (channel->segment_samples == 0)
+    return FALSE;
+
+  ratio = (gdouble) channel->segment_speech_samples / channel->segment_samples;
+  /* mean square value of the speech samples relative to full scale */
+  energy = channel->segment_speech_samples == 0 ? 0.0 :
+      (gdouble) channel->segment_sum_squares /
+      ((gdouble) channel->segment_speech_samples * 32768.0 * 32768.0);
+
+  if (ratio < deepspeech->min_speech_ratio || energy < deepspeech->min_segment_energy) {
+    GST_DEBUG_OBJECT (deepspeech, "Skipping segment of %" G_GUINT64_FORMAT
+        " samples (speech ratio %f, energy %f)", channel->segment_samples,
+        ratio, energy);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void
+gst_deepspeech_reset_segment (GstDeepSpeechChannel * channel)
+{
+  channel->in_speech = FALSE;
+  channel->segment_pts = GST_CLOCK_TIME_NONE;
+  channel->segment_samples = 0;
+  channel->segment_speech_samples = 0;
+  channel->segment_sum_squares = 0;
+  channel->quiet_bufs = 0;
+  channel->quiet_samples = 0;
+}
+
+static GstFlowReturn
+gst_deepspeech_end_segment (GstDeepSpeechChannel * channel)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  guint64 end = channel->audio.end;
+  GstClockTime duration;
+  GstFlowReturn ret;
+
+  duration = gst_deepspeech_samples_to_duration (deepspeech,
+      channel->segment_samples);
+  if (!gst_deepspeech_segment_is_speech (channel)) {
+    deepspeech->skipped_segments++;
+    deepspeech->skipped_duration += duration;
+
+    if (gst_deepspeech_feeds_incrementally (deepspeech)) {
+      /* the audio has been fed already, but the decode can still be saved */
+      ret = gst_deepspeech_queue_job (channel, GST_DEEPSPEECH_JOB_DISCARD, end,
+          0, channel->segment_pts, duration);
+    } else {
+      g_mutex_lock (&deepspeech->queue_lock);
+      channel->segment_offset = GST_DEEPSPEECH_NO_OFFSET;
+      gst_deepspeech_release_audio (channel);
+      g_mutex_unlock (&deepspeech->queue_lock);
+      ret = GST_FLOW_OK;
+    }
+  } else if (gst_deepspeech_feeds_incrementally (deepspeech)) {
+    ret = gst_deepspeech_queue_job (channel, GST_DEEPSPEECH_JOB_END, end, 0,
+        channel->segment_pts, duration);
+  } else {
+    ret = gst_deepspeech_queue_job (channel, GST_DEEPSPEECH_JOB_SEGMENT,
+        channel->segment_offset, channel->segment_samples,
+        channel->segment_pts, duration);
+  }
+
+  gst_deepspeech_reset_segment (channel);
+
+  return ret;
+}
+
+/* Ends whatever utterance any channel is in, at EOS or before the channels
+ * are reconfigured. */
+static void
+gst_deepspeech_end_segments (GstDeepSpeech * deepspeech)
+{
+  guint i;
+
+  for (i = 0; i < deepspeech->n_channels; i++) {
+    if (deepspeech->channels[i].segment_samples > 0)
+      gst_deepspeech_end_segment (&deepspeech->channels[i]);
+  }
+}
+
+/* Forgets the audio, queued segments and any held back EOS of every
+ * channel, after a flush or on the way back to READY, so that the element
+ * can take a new stream without reloading the model. Segments already
+ * being decoded finish in the background and their results are dropped.
+ * The statistics start over with the new stream. Called on the streaming
+ * thread, or with it stopped. */
+static void
+gst_deepspeech_reset_channels (GstDeepSpeech * deepspeech)
+{
+  GstDeepSpeechChannel *channel;
+  guint i;
+
+  g_mutex_lock (&deepspeech->queue_lock);
+  deepspeech->epoch++;
+  if (deepspeech->pending_eos) {
+    gst_event_unref (deepspeech->pending_eos);
+    deepspeech->pending_eos = NULL;
+  }
+  for (i = 0; i < deepspeech->n_channels; i++) {
+    channel = &deepspeech->channels[i];
+
+    while (!gst_queue_array_is_empty (channel->pending))
+      gst_queue_array_pop_head_struct (channel->pending);
+    channel->pending_segments = 0;
+    channel->feeding = FALSE;
+    channel->segment_offset = GST_DEEPSPEECH_NO_OFFSET;
+    gst_deepspeech_release_audio (channel);
+  }
+  deepspeech->max_queue_depth = 0;
+  deepspeech->dropped_segments = 0;
+  deepspeech->dropped_duration = 0;
+  g_mutex_unlock (&deepspeech->queue_lock);
+
+  g_mutex_lock (&deepspeech->stats_lock);
+  gst_deepspeech_stats_reset (&deepspeech->stats);
+  deepspeech->last_stats_time = g_get_monotonic_time ();
+  g_mutex_unlock (&deepspeech->stats_lock);
+  deepspeech->skipped_segments = 0;
+  deepspeech->skipped_duration = 0;
+
+  for (i = 0; i < deepspeech->n_channels; i++) {
+    channel = &deepspeech->channels[i];
+
+    gst_deepspeech_reset_segment (channel);
+    gst_deepspeech_ring_clear (&channel->preroll);
+    if (channel->vad)
+      gst_deepspeech_vad_reset (channel->vad);
+  }
+  if (deepspeech->convert)
+    gst_deepspeech_convert_reset (deepspeech->convert);
+}
+
+/* Adds the audio kept from just before speech started to the segment, so
+ * the first phoneme isn't clipped. */
+static GstFlowReturn
+gst_deepspeech_add_preroll (GstDeepSpeechChannel * channel)
+{
+  const gint16 *first, *second;
+  gsize first_len, second_len;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  gst_deepspeech_ring_peek (&channel->preroll, &first, &first_len,
+      &second, &second_len);
+  if (first_len > 0)
+    ret = gst_deepspeech_add_to_segment (channel, first, first_len);
+  if (ret == GST_FLOW_OK && second_len > 0)
+    ret = gst_deepspeech_add_to_segment (channel, second, second_len);
+  gst_deepspeech_ring_clear (&channel->preroll);
+
+  return ret;
+}
+
+/* Runs voice activity detection on at most segment_limit samples and adds
+ * them to the channel's current segment if they are part of an
+ * utterance. */
+static GstFlowReturn
+gst_deepspeech_process_samples (GstDeepSpeechChannel * channel,
+    const gint16 * samples, gsize n_samples, GstClockTime timestamp)
+{
+  GstDeepSpeech *deepspeech = channel->deepspeech;
+  gboolean speech, silent, too_long;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstClockTime trace = GST_DEEPSPEECH_TRACE_START ();
+
+  speech = gst_deepspeech_vad_is_speech (channel->vad, samples, n_samples);
+  GST_DEEPSPEECH_TRACE (GST_DEEPSPEECH_TRACE_VAD, deepspeech, channel->index,
+      trace, n_samples);
+
+  /* outside of speech only the most recent pre-roll-duration of audio is
+   * kept, nothing is fed to the model */
+  if (!speech && !channel->in_speech) {
+    gst_deepspeech_ring_write (&channel->preroll, samples, n_samples);
+    deepspeech->copied += n_samples * sizeof (gint16);
+    return GST_FLOW_OK;
+  }
+
+  /* a segment never outgrows its share of the ring */
+  if (channel->in_speech && channel->segment_samples + n_samples >
+      channel->segment_limit + channel->preroll.capacity) {
+    GST_DEBUG_OBJECT (deepspeech, "Forcing a cut after %" G_GUINT64_FORMAT
+        " samples", channel->segment_samples);
+    ret = gst_deepspeech_end_segment (channel);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
+
+  if (!channel->in_speech) {
+    gst_deepspeech_begin_segment (channel, timestamp);
+    ret = gst_deepspeech_add_preroll (channel);
+  }
+
+  if (ret == GST_FLOW_OK)
+    ret = gst_deepspeech_add_to_segment (channel, samples, n_samples);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  if (speech) {
+    channel->segment_speech_samples += n_samples;
+    channel->segment_sum_squares += channel->vad->sum_squares;
+    channel->quiet_bufs = 0;
+    channel->quiet_samples = 0;
+  } else {
+    channel->quiet_bufs++;
+    channel->quiet_samples += n_samples;
+  }
+
+  /* silence-duration and max-segment-duration are measured in samples, so
+   * they mean the same whatever buffer size upstream produces */
+  if (deepspeech->silence_duration > 0)
+    silent = channel->quiet_samples >= gst_deepspeech_duration_to_samples (
+        deepspeech, deepspeech->silence_duration);
+  else
+    silent = channel->quiet_bufs > deepspeech->silence_length;
+
+  too_long = channel->segment_samples >= channel->segment_limit;
+  if (too_long && !silent)
+    GST_DEBUG_OBJECT (deepspeech, "Forcing a cut after %" G_GUINT64_FORMAT
+        " samples", channel->segment_samples);
+
+  if (silent || too_long)
+    ret = gst_deepspeech_end_segment (channel);
+
+  return ret;
+}
+
+/* Splits interleaved frames into one run of samples per channel, in the
+ * element's scratch buffer. */
+static const gint16 *
+gst_deepspeech_deinterleave (GstDeepSpeech * deepspeech, const gint16 * samples,
+    gsize n_frames)
+{
+  guint n_channels = deepspeech->n_channels;
+  gsize i;
+  guint c;
+
+  if (n_frames * n_channels > deepspeech->planar_size) {
+    g_free (deepspeech->planar);
+    deepspeech->planar_size = n_frames * n_channels;
+    deepspeech->planar = g_new (gint16, deepspeech->planar_size);
+  }
+  for (c = 0; c < n_channels; c++) {
+    gint16 *out = deepspeech->planar + c * n_frames;
+
+    for (i = 0; i < n_frames; i++)
+      out[i] = samples[i * n_channels + c];
+  }
+  return deepspeech->planar;
+}
+
+/* transform function
+ * this function does the actual processing. The element is in passthrough
+ * mode, so buf is what goes downstream and must not be modified.
+ */
+static GstFlowReturn
+gst_deepspeech_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
+{
+  GstDeepSpeech *deepspeech = GST_DEEPSPEECH (trans);
+  GstMapInfo info;
+  const gint16 *samples;
+  gsize n_frames, pos, chunk;
+  guint64 limit;
+  GstClockTime timestamp;
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint c;
+
+  if (deepspeech->convert == NULL)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  limit = G_MAXUINT64;
+  for (c = 0; c < deepspeech->n_channels; c++) {
+    gst_deepspeech_prepare_segmenter (&deepspeech->channels[c]);
+    limit = MIN (limit, deepspeech->channels[c].segment_limit);
+  }
+
+  if (!gst_buffer_map (buf, &info, GST_MAP_READ)) {
+    GST_WARNING_OBJECT (deepspeech, "Could not map %" GST_PTR_FORMAT, buf);
+    return GST_FLOW_OK;
+  }
+  if (GST_BUFFER_IS_DISCONT (buf))
+    gst_deepspeech_convert_reset (deepspeech->convert);
+  n_frames = gst_deepspeech_convert_process (deepspeech->convert, info.data,
+      info.size, &samples);
+  if ((gconstpointer) samples != (gconstpointer) info.data)
+    deepspeech->copied += n_frames * deepspeech->n_channels * sizeof (gint16);
+  if (deepspeech->n_channels > 1) {
+    samples = gst_deepspeech_deinterleave (deepspeech, samples, n_frames);
+    deepspeech->copied += n_frames * deepspeech->n_channels * sizeof (gint16);
+  }
+  /* buffers without a timestamp continue where the previous one ended */
+  timestamp = GST_BUFFER_PTS (buf);
+  if (!GST_CLOCK_TIME_IS_VALID (timestamp))
+    timestamp = deepspeech->next_timestamp;
+
+  /* the audio is copied into the rings, so a buffer holding more than a
+   * whole segment is taken in pieces */
+  for (pos = 0; ret == GST_FLOW_OK && pos < n_frames; pos += chunk) {
+    chunk = MIN (n_frames - pos, limit);
+    for (c = 0; ret == GST_FLOW_OK && c < deepspeech->n_channels; c++)
+      ret = gst_deepspeech_process_samples (&deepspeech->channels[c],
+          samples + c * n_frames + pos, chunk, timestamp);
+
+    if (GST_CLOCK_TIME_IS_VALID (timestamp))
+      timestamp += gst_deepspeech_samples_to_duration (deepspeech, chunk);
+  }
+  gst_buffer_unmap (buf, &info);
+  deepspeech->next_timestamp = timestamp;
+
+  /* copied is only touched here, so the stats lock is taken once a buffer */
+  g_mutex_lock (&deepspeech->stats_lock);
+  deepspeech->stats.bytes_copied += deepspeech->copied;
+  g_mutex_unlock (&deepspeech->stats_lock);
+  deepspeech->copied = 0;
+  gst_deepspeech_maybe_post_stats (deepspeech);
+
+  return ret;
+}
+
+
+/* entry point to initialize the plug-in
+ * initialize the plug-in itself
+ * register the element factories and other features
+ */
+static gboolean
+deepspeech_init (GstPlugin * deepspeech)
+{
+  /* debug category for filtering log messages
+   */
+  GST_DEBUG_CATEGORY_INIT (gst_deepspeech_debug, "deepspeech",
+      0, "Performs speech recognition using Mozilla's DeepSpeech model.");
+  gst_deepspeech_trace_init ();
+
+  if (!gst_element_register (deepspeech, "deepspeech", GST_RANK_NONE,
+          GST_TYPE_DEEPSPEECH))
+    return FALSE;
 
-  return gst_element_register (deepspeech, "deepspeech", GST_RANK_NONE,
-      GST_TYPE_DEEPSPEECH);
+  return gst_element_register (deepspeech, "deepspeechbatch", GST_RANK_NONE,
+      GST_TYPE_DEEPSPEECH_BATCH);
 }
 
 /* gstreamer looks for this structure to register plugins
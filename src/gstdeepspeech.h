@@ -46,7 +46,13 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
+#include <gst/base/gstqueuearray.h>
 #include "deepspeech.h"
+#include "gstdeepspeechconvert.h"
+#include "gstdeepspeechmodel.h"
+#include "gstdeepspeechring.h"
+#include "gstdeepspeechstats.h"
+#include "gstdeepspeechvad.h"
 
 G_BEGIN_DECLS
 
@@ -61,28 +67,152 @@ G_BEGIN_DECLS
 #define GST_IS_DEEPSPEECH_CLASS(klass) \
   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_DEEPSPEECH))
 
+typedef enum
+{
+  GST_DEEPSPEECH_BACKPRESSURE_BLOCK,
+  GST_DEEPSPEECH_BACKPRESSURE_DROP_OLDEST,
+  GST_DEEPSPEECH_BACKPRESSURE_DROP_NEWEST
+} GstDeepSpeechBackpressure;
+
+typedef enum
+{
+  GST_DEEPSPEECH_FEED_MODE_SEGMENT,
+  GST_DEEPSPEECH_FEED_MODE_INCREMENTAL
+} GstDeepSpeechFeedMode;
+
+typedef enum
+{
+  GST_DEEPSPEECH_MODE_LIVE,
+  GST_DEEPSPEECH_MODE_OFFLINE
+} GstDeepSpeechMode;
+
+typedef enum
+{
+  GST_DEEPSPEECH_PRELOAD_NONE,
+  GST_DEEPSPEECH_PRELOAD_WARM_UP,
+  GST_DEEPSPEECH_PRELOAD_LOCK
+} GstDeepSpeechPreload;
+
 typedef struct _GstDeepSpeech      GstDeepSpeech;
 typedef struct _GstDeepSpeechClass GstDeepSpeechClass;
+typedef struct _GstDeepSpeechChannel GstDeepSpeechChannel;
+
+/* Segmentation and decoding state of one input channel. Input mixed down
+ * to mono has a single channel; with split-channels every input channel is
+ * segmented on its own and decoded by its own worker threads, each with its
+ * own stream of the shared model. The streaming thread owns the segmenter
+ * fields and the element's queue_lock guards the rest; interim_samples and
+ * last_interim are only used by the single worker of live mode. */
+struct _GstDeepSpeechChannel
+{
+  GstDeepSpeech    *deepspeech;
+  guint            index;
+  gint             quiet_bufs;
+  guint64          quiet_samples;
+  guint64          segment_samples;
+  guint64          segment_speech_samples;
+  guint64          segment_sum_squares;
+  gboolean         in_speech;
+  GstDeepSpeechVad *vad;
+  GstDeepSpeechRing preroll;
+  GstDeepSpeechRing audio;
+  guint64          segment_limit;
+  guint64          segment_offset;
+  GstClockTime     segment_pts;
+  guint64          interim_samples;
+  gchar            *last_interim;
+  GThread          **workers;
+  guint            n_workers;
+  GstQueueArray    *pending;
+  guint            pending_segments;
+  GQueue           decoding;
+  gboolean         posting;
+  gboolean         feeding;
+  gboolean         late_segment;
+  GstClockTime     feed_time;
+};
 
 struct _GstDeepSpeech
 {
   GstBaseTransform element;
   GstPad           *sinkpad, *srcpad;
-  gint             quiet_bufs;
-  ModelState       *model_state;
-  StreamingState   *streaming_state;
-  GstBuffer        *buf;
-  GThreadPool      *thread_pool;
+  GstPad           *textpad;
+  GMutex           text_lock;
+  gboolean         text_need_caps;
+  gboolean         text_need_segment;
+  gboolean         text_json;
+  GstClockTime     text_earliest_time;
+  gdouble          text_proportion;
+  GstDeepSpeechChannel *channels;
+  guint            n_channels;
+  gint16           *planar;
+  gsize            planar_size;
+  GstClockTime     next_timestamp;
+  GstDeepSpeechModel *model;
+  GQueue           spare_streams;
+  GMutex           stream_lock;
+  GMutex           queue_lock;
+  GCond            queue_cond;
+  gboolean         worker_stop;
+  gboolean         flushing;
+  guint            epoch;
+  GstEvent         *pending_eos;
+  gboolean         forwarding_eos;
+  guint64          dropped_segments;
+  GstClockTime     dropped_duration;
+  guint            max_queue_depth;
+  GstClockTime     max_latency;
+  GMutex           stats_lock;
+  GstDeepSpeechStats stats;
+  guint64          copied;
+  GstClockTime     stats_interval;
+  gint64           last_stats_time;
+  guint64          skipped_segments;
+  GstClockTime     skipped_duration;
   gchar            *speech_model_path;
   gchar            *scorer_path;
   gint             beam_width;
+  gboolean         adaptive_beam;
+  gint             min_beam_width;
+  gint             spare_beam_width;
+  gboolean         spare_streams_stale;
+  GHashTable       *hot_words;
+  gdouble          lm_alpha;
+  gdouble          lm_beta;
+  gboolean         lm_alpha_set;
+  gboolean         lm_beta_set;
   gdouble          silence_threshold;
   gint             silence_length;
+  GstClockTime     silence_duration;
+  GstClockTime     max_segment_duration;
+  GstDeepSpeechVadType vad_type;
+  GstClockTime     pre_roll_duration;
+  gdouble          min_speech_ratio;
+  gdouble          min_segment_energy;
+  guint            max_pending_segments;
+  GstDeepSpeechBackpressure backpressure;
+  GstDeepSpeechFeedMode feed_mode;
+  GstClockTime     interim_results_interval;
+  gboolean         post_messages;
+  gboolean         metadata;
+  guint            candidates;
+  gboolean         split_channels;
+  GstDeepSpeechMode mode;
+  guint            decoders;
+  GstDeepSpeechPreload preload;
+  gboolean         offline;
+  GstDeepSpeechConvert *convert;
+  gint             rate;
 };
 
 struct _GstDeepSpeechClass 
 {
-  GstElementClass parent_class;
+  GstBaseTransformClass parent_class;
+
+  /* actions */
+  void (*add_hot_word) (GstDeepSpeech * deepspeech, const gchar * word, gfloat boost);
+  void (*erase_hot_word) (GstDeepSpeech * deepspeech, const gchar * word);
+  void (*clear_hot_words) (GstDeepSpeech * deepspeech);
 };
 
 GType gst_deepspeech_get_type (void);
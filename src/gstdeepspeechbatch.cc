@@ -0,0 +1,1032 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * SECTION:element-deepspeechbatch
+ *
+ * Transcribes many independent audio streams with one shared model. Each
+ * request sink pad is segmented on its own, and the audio of every pad is
+ * decoded by a fixed pool of worker threads, so the number of threads does
+ * not grow with the number of streams. Results are posted as "deepspeech"
+ * element messages like those of the deepspeech element, with the "pad" and
+ * "stream-id" fields naming the stream they belong to. Like the deepspeech
+ * element, pads take common raw formats and convert them to the rate of the
+ * model.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 -m deepspeechbatch name=b \
+ *     filesrc location=call1.wav ! decodebin ! b.sink_0 \
+ *     filesrc location=call2.wav ! decodebin ! b.sink_1
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <gst/gst.h>
+#include <deepspeech.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gstdeepspeechbatch.h"
+#include "gstdeepspeechdefaults.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_deepspeech_batch_debug);
+#define GST_CAT_DEFAULT gst_deepspeech_batch_debug
+
+#define DEFAULT_SILENCE_DURATION (500 * GST_MSECOND)
+#define DEFAULT_WORKERS 0
+
+/* Amount of audio each pad can have waiting to be fed before its upstream
+ * is blocked */
+#define PAD_RING_DURATION (10 * GST_SECOND)
+
+/* Jobs a worker takes from one pad before moving on to the next, so that
+ * busy streams don't starve the others */
+#define JOBS_PER_RUN 4
+
+/* Initial number of jobs each pad's queue has room for */
+#define PENDING_JOBS_SIZE 16
+
+enum
+{
+  PROP_0,
+  PROP_SPEECH_MODEL,
+  PROP_SCORER,
+  PROP_BEAM_WIDTH,
+  PROP_SILENCE_THRESHOLD,
+  PROP_SILENCE_DURATION,
+  PROP_MAX_SEGMENT_DURATION,
+  PROP_VAD,
+  PROP_PRE_ROLL_DURATION,
+  PROP_WORKERS
+};
+
+static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (GST_DEEPSPEECH_AUDIO_CAPS)
+    );
+
+/* Work for a pad's worker: audio to feed to the pad's stream, the end of an
+ * utterance, or a stream to throw away after a flush. The audio stays in
+ * the pad's sample ring until the job is done. */
+typedef enum
+{
+  GST_DEEPSPEECH_BATCH_JOB_FEED,
+  GST_DEEPSPEECH_BATCH_JOB_END,
+  GST_DEEPSPEECH_BATCH_JOB_DISCARD
+} GstDeepSpeechBatchJobType;
+
+typedef struct
+{
+  GstDeepSpeechBatchJobType type;
+  guint64 offset;
+  gsize n_samples;
+  GstClockTime timestamp;
+  GstClockTime duration;
+} GstDeepSpeechBatchJob;
+
+#define gst_deepspeech_batch_parent_class parent_class
+G_DEFINE_TYPE (GstDeepSpeechBatch, gst_deepspeech_batch, GST_TYPE_ELEMENT);
+G_DEFINE_TYPE (GstDeepSpeechBatchPad, gst_deepspeech_batch_pad, GST_TYPE_PAD);
+
+static void gst_deepspeech_batch_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_deepspeech_batch_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static void gst_deepspeech_batch_finalize (GObject * object);
+static GstStateChangeReturn gst_deepspeech_batch_change_state (GstElement * element,
+    GstStateChange transition);
+static GstPad * gst_deepspeech_batch_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_deepspeech_batch_release_pad (GstElement * element, GstPad * pad);
+
+static gboolean gst_deepspeech_batch_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event);
+static GstFlowReturn gst_deepspeech_batch_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buf);
+static void gst_deepspeech_batch_run (gpointer data, gpointer user_data);
+
+/* GstDeepSpeechBatchPad */
+
+static void
+gst_deepspeech_batch_pad_finalize (GObject * object)
+{
+  GstDeepSpeechBatchPad *pad = GST_DEEPSPEECH_BATCH_PAD (object);
+
+  if (pad->vad)
+    gst_deepspeech_vad_free (pad->vad);
+  if (pad->convert)
+    gst_deepspeech_convert_free (pad->convert);
+  gst_deepspeech_ring_free (&pad->preroll);
+  gst_deepspeech_ring_free (&pad->audio);
+  gst_queue_array_free (pad->pending);
+
+  G_OBJECT_CLASS (gst_deepspeech_batch_pad_parent_class)->finalize (object);
+}
+
+static void
+gst_deepspeech_batch_pad_class_init (GstDeepSpeechBatchPadClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->finalize = gst_deepspeech_batch_pad_finalize;
+}
+
+static void
+gst_deepspeech_batch_pad_init (GstDeepSpeechBatchPad * pad)
+{
+  pad->segment_pts = GST_CLOCK_TIME_NONE;
+  gst_segment_init (&pad->segment, GST_FORMAT_TIME);
+  pad->pending = gst_queue_array_new_for_struct (sizeof (GstDeepSpeechBatchJob),
+      PENDING_JOBS_SIZE);
+}
+
+/* GstDeepSpeechBatch */
+
+static void
+gst_deepspeech_batch_class_init (GstDeepSpeechBatchClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *gstelement_class;
+
+  gobject_class = (GObjectClass *) klass;
+  gstelement_class = (GstElementClass *) klass;
+
+  GST_DEBUG_CATEGORY_INIT (gst_deepspeech_batch_debug, "deepspeechbatch",
+      0, "Performs speech recognition on many streams with one model.");
+
+  gobject_class->set_property = gst_deepspeech_batch_set_property;
+  gobject_class->get_property = gst_deepspeech_batch_get_property;
+  gobject_class->finalize = gst_deepspeech_batch_finalize;
+
+  gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_deepspeech_batch_change_state);
+  gstelement_class->request_new_pad = GST_DEBUG_FUNCPTR (gst_deepspeech_batch_request_new_pad);
+  gstelement_class->release_pad = GST_DEBUG_FUNCPTR (gst_deepspeech_batch_release_pad);
+
+  g_object_class_install_property (gobject_class, PROP_SPEECH_MODEL,
+      g_param_spec_string ("speech-model", "Speech Model", GST_DEEPSPEECH_SPEECH_MODEL_BLURB,
+          DEFAULT_SPEECH_MODEL, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SCORER,
+      g_param_spec_string ("scorer", "Scorer", "Location of the scorer file.",
+          DEFAULT_SCORER, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_BEAM_WIDTH,
+      g_param_spec_int ("beam-width", "Beam Width", GST_DEEPSPEECH_BEAM_WIDTH_BLURB,
+          0, G_MAXINT, DEFAULT_BEAM_WIDTH, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SILENCE_THRESHOLD,
+      g_param_spec_double ("silence-threshold", "Silence Threshold", GST_DEEPSPEECH_SILENCE_THRESHOLD_BLURB ("silence-duration"),
+          0, 1.0, DEFAULT_SILENCE_THRESHOLD, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_SILENCE_DURATION,
+      g_param_spec_uint64 ("silence-duration", "Silence Duration", "Amount of audio (in nanoseconds) which must be below the silence threshold before segmentation occurs.",
+          0, G_MAXUINT64, DEFAULT_SILENCE_DURATION, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_MAX_SEGMENT_DURATION,
+      g_param_spec_uint64 ("max-segment-duration", "Max Segment Duration", "Force segmentation once a segment holds this much audio (in nanoseconds), even without silence (0 = unlimited).",
+          0, G_MAXUINT64, DEFAULT_MAX_SEGMENT_DURATION, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_VAD,
+      g_param_spec_enum ("vad", "Voice Activity Detector", GST_DEEPSPEECH_VAD_BLURB,
+          GST_TYPE_DEEPSPEECH_VAD_TYPE, DEFAULT_VAD, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_PRE_ROLL_DURATION,
+      g_param_spec_uint64 ("pre-roll-duration", "Pre-roll Duration", GST_DEEPSPEECH_PRE_ROLL_DURATION_BLURB,
+          0, G_MAXUINT64, DEFAULT_PRE_ROLL_DURATION, G_PARAM_READWRITE));
+  g_object_class_install_property (gobject_class, PROP_WORKERS,
+      g_param_spec_uint ("workers", "Workers", "Number of threads decoding the streams of all pads (0 = one per processor).",
+          0, G_MAXUINT, DEFAULT_WORKERS,
+          (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY)));
+
+  gst_element_class_set_details_simple(gstelement_class,
+    "deepspeechbatch",
+    "Sink/Audio",
+    "Performs speech recognition on many streams using one Mozilla DeepSpeech model",
+    "Mike Sheldon <elleo@gnu.org>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_pad_template_new_from_static_pad_template_with_gtype (&sink_factory,
+          GST_TYPE_DEEPSPEECH_BATCH_PAD));
+}
+
+static void
+gst_deepspeech_batch_init (GstDeepSpeechBatch * batch)
+{
+  batch->speech_model_path = g_strdup (DEFAULT_SPEECH_MODEL);
+  batch->scorer_path = g_strdup (DEFAULT_SCORER);
+  batch->beam_width = DEFAULT_BEAM_WIDTH;
+  batch->silence_threshold = DEFAULT_SILENCE_THRESHOLD;
+  batch->silence_duration = DEFAULT_SILENCE_DURATION;
+  batch->max_segment_duration = DEFAULT_MAX_SEGMENT_DURATION;
+  batch->vad_type = DEFAULT_VAD;
+  batch->pre_roll_duration = DEFAULT_PRE_ROLL_DURATION;
+  batch->workers = DEFAULT_WORKERS;
+  g_mutex_init (&batch->lock);
+  g_cond_init (&batch->cond);
+
+  /* results are the only output, so the bin waits for our EOS */
+  GST_OBJECT_FLAG_SET (batch, GST_ELEMENT_FLAG_SINK);
+}
+
+static void
+gst_deepspeech_batch_finalize (GObject * object)
+{
+  GstDeepSpeechBatch *batch = GST_DEEPSPEECH_BATCH (object);
+
+  g_mutex_clear (&batch->lock);
+  g_cond_clear (&batch->cond);
+  g_free (batch->speech_model_path);
+  g_free (batch->scorer_path);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static GstPad *
+gst_deepspeech_batch_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstDeepSpeechBatch *batch = GST_DEEPSPEECH_BATCH (element);
+  GstDeepSpeechBatchPad *pad;
+  gchar *pad_name;
+  guint stream_id;
+
+  g_mutex_lock (&batch->lock);
+  if (name && sscanf (name, "sink_%u", &stream_id) == 1) {
+    batch->next_stream_id = MAX (batch->next_stream_id, stream_id + 1);
+  } else {
+    stream_id = batch->next_stream_id++;
+  }
+  g_mutex_unlock (&batch->lock);
+
+  pad_name = g_strdup_printf ("sink_%u", stream_id);
+  pad = GST_DEEPSPEECH_BATCH_PAD (g_object_new (GST_TYPE_DEEPSPEECH_BATCH_PAD,
+          "name", pad_name, "direction", GST_PAD_SINK, "template", templ, NULL));
+  g_free (pad_name);
+  pad->stream_id = stream_id;
+
+  gst_pad_set_event_function (GST_PAD_CAST (pad),
+      GST_DEBUG_FUNCPTR (gst_deepspeech_batch_sink_event));
+  gst_pad_set_chain_function (GST_PAD_CAST (pad),
+      GST_DEBUG_FUNCPTR (gst_deepspeech_batch_chain));
+
+  if (!gst_element_add_pad (element, GST_PAD_CAST (pad))) {
+    gst_object_unref (pad);
+    return NULL;
+  }
+
+  g_mutex_lock (&batch->lock);
+  batch->active_pads++;
+  g_mutex_unlock (&batch->lock);
+
+  return GST_PAD_CAST (pad);
+}
+
+/* Drops everything queued for the pad. The job a worker may be running
+ * keeps its audio until it is done. Must be called with the lock held. */
+static void
+gst_deepspeech_batch_pad_clear (GstDeepSpeechBatchPad * pad)
+{
+  while (!gst_queue_array_is_empty (pad->pending))
+    gst_queue_array_pop_head_struct (pad->pending);
+  gst_deepspeech_ring_release (&pad->audio,
+      pad->busy ? pad->busy_offset : pad->audio.end);
+}
+
+/* Frees the pad's stream once no worker is running it any more. Must be
+ * called with the lock held. */
+static void
+gst_deepspeech_batch_pad_stop (GstDeepSpeechBatch * batch,
+    GstDeepSpeechBatchPad * pad)
+{
+  pad->flushing = TRUE;
+  gst_deepspeech_batch_pad_clear (pad);
+  g_cond_broadcast (&batch->cond);
+  while (pad->scheduled)
+    g_cond_wait (&batch->cond, &batch->lock);
+
+  if (pad->stream) {
+    DS_FreeStream (pad->stream);
+    pad->stream = NULL;
+  }
+}
+
+static void
+gst_deepspeech_batch_post_eos (GstDeepSpeechBatch * batch)
+{
+  GstMessage *msg;
+
+  GST_DEBUG_OBJECT (batch, "All streams are done");
+  msg = gst_message_new_eos (GST_OBJECT (batch));
+  gst_element_post_message (GST_ELEMENT (batch), msg);
+}
+
+/* Marks the pad as done once it received EOS and all its audio has been
+ * decoded. Returns TRUE if that makes it the last pad to finish. Must be
+ * called with the lock held. */
+static gboolean
+gst_deepspeech_batch_pad_maybe_finish (GstDeepSpeechBatch * batch,
+    GstDeepSpeechBatchPad * pad)
+{
+  if (!pad->eos || pad->finished || pad->scheduled)
+    return FALSE;
+
+  pad->finished = TRUE;
+  batch->active_pads--;
+  return batch->active_pads == 0;
+}
+
+static void
+gst_deepspeech_batch_release_pad (GstElement * element, GstPad * pad)
+{
+  GstDeepSpeechBatch *batch = GST_DEEPSPEECH_BATCH (element);
+  GstDeepSpeechBatchPad *bpad = GST_DEEPSPEECH_BATCH_PAD (pad);
+  gboolean last = FALSE;
+
+  g_mutex_lock (&batch->lock);
+  gst_deepspeech_batch_pad_stop (batch, bpad);
+  if (!bpad->finished) {
+    bpad->finished = TRUE;
+    batch->active_pads--;
+    /* the remaining pads may all be waiting for this one */
+    last = batch->active_pads == 0 && GST_ELEMENT_CAST (batch)->numsinkpads > 1;
+  }
+  g_mutex_unlock (&batch->lock);
+
+  gst_element_remove_pad (element, pad);
+  if (last)
+    gst_deepspeech_batch_post_eos (batch);
+}
+
+/* Pads decode with the scorer the model was loaded with. */
+static StreamingState *
+gst_deepspeech_batch_create_stream (GstDeepSpeechBatch * batch)
+{
+  GstDeepSpeechStreamSettings settings;
+
+  settings.beam_width = batch->beam_width;
+  settings.hot_words = NULL;
+  return gst_deepspeech_model_create_stream (batch->model, &settings);
+}
+
+static void
+gst_deepspeech_batch_release_model (GstDeepSpeechBatch * batch)
+{
+  if (batch->model) {
+    gst_deepspeech_model_release (batch->model);
+    batch->model = NULL;
+  }
+}
+
+/* The model is only loaded on the NULL to READY transition, once all the
+ * properties from the pipeline description have been applied. Pads create
+ * their streams from it when they first get audio. */
+static gboolean
+gst_deepspeech_batch_start (GstDeepSpeechBatch * batch)
+{
+  GError *error = NULL;
+  StreamingState *stream;
+  guint workers;
+
+  batch->model = gst_deepspeech_model_acquire (batch->speech_model_path,
+      batch->scorer_path);
+  /* checks that streams can be created before any pad needs one */
+  stream = batch->model ? gst_deepspeech_batch_create_stream (batch) : NULL;
+  if (stream == NULL) {
+    GST_ELEMENT_ERROR (batch, RESOURCE, OPEN_READ,
+        ("Could not load model."),
+        ("speech-model=%s scorer=%s", batch->speech_model_path,
+            batch->scorer_path));
+    gst_deepspeech_batch_release_model (batch);
+    return FALSE;
+  }
+  DS_FreeStream (stream);
+  /* every pad's audio is converted to this rate */
+  batch->rate = DS_GetModelSampleRate (batch->model->model_state);
+
+  workers = batch->workers > 0 ? batch->workers : g_get_num_processors ();
+  batch->stopping = FALSE;
+  batch->pool = g_thread_pool_new (gst_deepspeech_batch_run, batch, workers,
+      FALSE, &error);
+  if (batch->pool == NULL) {
+    GST_ELEMENT_ERROR (batch, RESOURCE, FAILED,
+        ("Could not start worker threads."), ("%s", error->message));
+    g_error_free (error);
+    gst_deepspeech_batch_release_model (batch);
+    return FALSE;
+  }
+  GST_DEBUG_OBJECT (batch, "Started %u workers", workers);
+
+  return TRUE;
+}
+
+static void
+gst_deepspeech_batch_stop (GstDeepSpeechBatch * batch)
+{
+  GList *l;
+
+  if (batch->pool) {
+    /* workers finish the jobs they are running and drop the rest */
+    g_mutex_lock (&batch->lock);
+    batch->stopping = TRUE;
+    g_mutex_unlock (&batch->lock);
+    g_thread_pool_free (batch->pool, FALSE, TRUE);
+    batch->pool = NULL;
+  }
+
+  GST_OBJECT_LOCK (batch);
+  g_mutex_lock (&batch->lock);
+  for (l = GST_ELEMENT_CAST (batch)->sinkpads; l; l = l->next)
+    gst_deepspeech_batch_pad_stop (batch, GST_DEEPSPEECH_BATCH_PAD (l->data));
+  g_mutex_unlock (&batch->lock);
+  GST_OBJECT_UNLOCK (batch);
+
+  gst_deepspeech_batch_release_model (batch);
+}
+
+static void
+gst_deepspeech_batch_set_flushing (GstDeepSpeechBatch * batch, gboolean flushing)
+{
+  GList *l;
+
+  GST_OBJECT_LOCK (batch);
+  g_mutex_lock (&batch->lock);
+  for (l = GST_ELEMENT_CAST (batch)->sinkpads; l; l = l->next) {
+    GstDeepSpeechBatchPad *pad = GST_DEEPSPEECH_BATCH_PAD (l->data);
+
+    pad->flushing = flushing;
+    if (!flushing) {
+      if (pad->finished)
+        batch->active_pads++;
+      pad->eos = FALSE;
+      pad->finished = FALSE;
+    }
+  }
+  g_cond_broadcast (&batch->cond);
+  g_mutex_unlock (&batch->lock);
+  GST_OBJECT_UNLOCK (batch);
+}
+
+static GstStateChangeReturn
+gst_deepspeech_batch_change_state (GstElement * element, GstStateChange transition)
+{
+  GstDeepSpeechBatch *batch = GST_DEEPSPEECH_BATCH (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      gst_deepspeech_model_preload_from_env ();
+      if (!gst_deepspeech_batch_start (batch))
+        return GST_STATE_CHANGE_FAILURE;
+      break;
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_deepspeech_batch_set_flushing (batch, FALSE);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* Unblock streaming threads waiting for ring space */
+      gst_deepspeech_batch_set_flushing (batch, TRUE);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      gst_deepspeech_batch_stop (batch);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+static void
+gst_deepspeech_batch_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstDeepSpeechBatch *batch = GST_DEEPSPEECH_BATCH (object);
+
+  switch (prop_id) {
+    case PROP_SPEECH_MODEL:
+      g_free (batch->speech_model_path);
+      batch->speech_model_path = g_value_dup_string (value);
+      break;
+    case PROP_SCORER:
+      g_free (batch->scorer_path);
+      batch->scorer_path = g_value_dup_string (value);
+      break;
+    case PROP_BEAM_WIDTH:
+      batch->beam_width = g_value_get_int (value);
+      break;
+    case PROP_SILENCE_THRESHOLD:
+      batch->silence_threshold = g_value_get_double (value);
+      break;
+    case PROP_SILENCE_DURATION:
+      batch->silence_duration = g_value_get_uint64 (value);
+      break;
+    case PROP_MAX_SEGMENT_DURATION:
+      batch->max_segment_duration = g_value_get_uint64 (value);
+      break;
+    case PROP_VAD:
+      batch->vad_type = (GstDeepSpeechVadType) g_value_get_enum (value);
+      break;
+    case PROP_PRE_ROLL_DURATION:
+      batch->pre_roll_duration = g_value_get_uint64 (value);
+      break;
+    case PROP_WORKERS:
+      batch->workers = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_deepspeech_batch_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstDeepSpeechBatch *batch = GST_DEEPSPEECH_BATCH (object);
+
+  switch (prop_id) {
+    case PROP_SPEECH_MODEL:
+      g_value_set_string (value, batch->speech_model_path);
+      break;
+    case PROP_SCORER:
+      g_value_set_string (value, batch->scorer_path);
+      break;
+    case PROP_BEAM_WIDTH:
+      g_value_set_int (value, batch->beam_width);
+      break;
+    case PROP_SILENCE_THRESHOLD:
+      g_value_set_double (value, batch->silence_threshold);
+      break;
+    case PROP_SILENCE_DURATION:
+      g_value_set_uint64 (value, batch->silence_duration);
+      break;
+    case PROP_MAX_SEGMENT_DURATION:
+      g_value_set_uint64 (value, batch->max_segment_duration);
+      break;
+    case PROP_VAD:
+      g_value_set_enum (value, batch->vad_type);
+      break;
+    case PROP_PRE_ROLL_DURATION:
+      g_value_set_uint64 (value, batch->pre_roll_duration);
+      break;
+    case PROP_WORKERS:
+      g_value_set_uint (value, batch->workers);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static GstMessage *
+gst_deepspeech_batch_message_new (GstDeepSpeechBatch * batch,
+    GstDeepSpeechBatchPad * pad, GstClockTime timestamp, GstClockTime duration,
+    const char * text)
+{
+  GstStructure *s;
+  GstClockTime running_time, stream_time, end_running_time, end_stream_time;
+  GstClockTime end = GST_CLOCK_TIME_NONE;
+
+  if (GST_CLOCK_TIME_IS_VALID (timestamp) && GST_CLOCK_TIME_IS_VALID (duration))
+    end = timestamp + duration;
+  running_time = gst_segment_to_running_time (&pad->segment, GST_FORMAT_TIME,
+      timestamp);
+  stream_time = gst_segment_to_stream_time (&pad->segment, GST_FORMAT_TIME,
+      timestamp);
+  end_running_time = gst_segment_to_running_time (&pad->segment, GST_FORMAT_TIME,
+      end);
+  end_stream_time = gst_segment_to_stream_time (&pad->segment, GST_FORMAT_TIME,
+      end);
+
+  s = gst_structure_new ("deepspeech",
+      "pad", G_TYPE_STRING, GST_PAD_NAME (pad),
+      "stream-id", G_TYPE_UINT, pad->stream_id,
+      "timestamp", G_TYPE_UINT64, timestamp,
+      "stream-time", G_TYPE_UINT64, stream_time,
+      "running-time", G_TYPE_UINT64, running_time,
+      "duration", G_TYPE_UINT64, duration,
+      "end-stream-time", G_TYPE_UINT64, end_stream_time,
+      "end-running-time", G_TYPE_UINT64, end_running_time,
+      "intermediate", G_TYPE_BOOLEAN, FALSE,
+      "text", G_TYPE_STRING, text, NULL);
+
+  return gst_message_new_element (GST_OBJECT (batch), s);
+}
+
+/* Feeds one job to the pad's stream, creating the stream first if this is
+ * the start of an utterance, and posts the text when the utterance ends. */
+static void
+gst_deepspeech_batch_process_job (GstDeepSpeechBatch * batch,
+    GstDeepSpeechBatchPad * pad, const GstDeepSpeechBatchJob * job,
+    const gint16 * first, gsize first_len, const gint16 * second, gsize second_len)
+{
+  char *result = NULL;
+
+  if (job->type == GST_DEEPSPEECH_BATCH_JOB_DISCARD) {
+    if (pad->stream) {
+      DS_FreeStream (pad->stream);
+      pad->stream = NULL;
+    }
+    return;
+  }
+
+  if (pad->stream == NULL && job->type == GST_DEEPSPEECH_BATCH_JOB_FEED)
+    pad->stream = gst_deepspeech_batch_create_stream (batch);
+  if (pad->stream == NULL)
+    return;
+
+  gst_deepspeech_model_lock (batch->model);
+  if (first_len > 0)
+    DS_FeedAudioContent (pad->stream, first, (unsigned int) first_len);
+  if (second_len > 0)
+    DS_FeedAudioContent (pad->stream, second, (unsigned int) second_len);
+  if (job->type == GST_DEEPSPEECH_BATCH_JOB_END) {
+    /* DS_FinishStream frees the stream too */
+    result = DS_FinishStream (pad->stream);
+    pad->stream = NULL;
+  }
+  gst_deepspeech_model_unlock (batch->model);
+
+  if (result) {
+    if (strlen (result) > 0) {
+      GstMessage *msg = gst_deepspeech_batch_message_new (batch, pad,
+          job->timestamp, job->duration, result);
+      gst_element_post_message (GST_ELEMENT (batch), msg);
+    }
+    DS_FreeString (result);
+  }
+}
+
+/* Thread pool function, run with one pad at a time. A pad is in the pool's
+ * queue at most once; after a few jobs it goes to the back of it if it has
+ * more, so every stream gets its turn whatever the thread count. */
+static void
+gst_deepspeech_batch_run (gpointer data, gpointer user_data)
+{
+  GstDeepSpeechBatchPad *pad = GST_DEEPSPEECH_BATCH_PAD (data);
+  GstDeepSpeechBatch *batch = GST_DEEPSPEECH_BATCH (user_data);
+  GstDeepSpeechBatchJob job;
+  const gint16 *first, *second;
+  gsize first_len, second_len;
+  gboolean last;
+  guint i;
+
+  g_mutex_lock (&batch->lock);
+  for (i = 0; i < JOBS_PER_RUN && !batch->stopping && !pad->flushing &&
+      !gst_queue_array_is_empty (pad->pending); i++) {
+    job = *(GstDeepSpeechBatchJob *) gst_queue_array_pop_head_struct (pad->pending);
+    gst_deepspeech_ring_peek_range (&pad->audio, job.offset, job.n_samples,
+        &first, &first_len, &second, &second_len);
+    pad->busy = TRUE;
+    pad->busy_offset = job.offset;
+    g_mutex_unlock (&batch->lock);
+
+    gst_deepspeech_batch_process_job (batch, pad, &job, first, first_len,
+        second, second_len);
+
+    g_mutex_lock (&batch->lock);
+    pad->busy = FALSE;
+    gst_deepspeech_ring_release (&pad->audio, job.offset + job.n_samples);
+    g_cond_broadcast (&batch->cond);
+  }
+
+  if (!gst_queue_array_is_empty (pad->pending) && !batch->stopping &&
+      !pad->flushing) {
+    g_thread_pool_push (batch->pool, pad, NULL);
+    g_mutex_unlock (&batch->lock);
+    return;
+  }
+
+  pad->scheduled = FALSE;
+  last = gst_deepspeech_batch_pad_maybe_finish (batch, pad);
+  g_cond_broadcast (&batch->cond);
+  g_mutex_unlock (&batch->lock);
+
+  if (last)
+    gst_deepspeech_batch_post_eos (batch);
+  gst_object_unref (pad);
+}
+
+/* Queues a job for the pad and makes sure a worker will get to it. Feed
+ * jobs for audio right after that of the last queued one are merged into
+ * it, so a worker feeds as much as it can at once. Must be called with the
+ * lock held. */
+static void
+gst_deepspeech_batch_pad_queue_job (GstDeepSpeechBatch * batch,
+    GstDeepSpeechBatchPad * pad, GstDeepSpeechBatchJobType type,
+    guint64 offset, gsize n_samples, GstClockTime timestamp,
+    GstClockTime duration)
+{
+  GstDeepSpeechBatchJob job = { type, offset, n_samples, timestamp, duration };
+  GstDeepSpeechBatchJob *tail;
+
+  tail = (GstDeepSpeechBatchJob *) gst_queue_array_peek_tail_struct (pad->pending);
+  if (type == GST_DEEPSPEECH_BATCH_JOB_FEED && tail &&
+      tail->type == GST_DEEPSPEECH_BATCH_JOB_FEED &&
+      tail->offset + tail->n_samples == offset) {
+    tail->n_samples += n_samples;
+  } else {
+    gst_queue_array_push_tail_struct (pad->pending, &job);
+  }
+
+  if (!pad->scheduled && batch->pool) {
+    pad->scheduled = TRUE;
+    g_thread_pool_push (batch->pool, gst_object_ref (pad), NULL);
+  }
+}
+
+/* Copies audio into the pad's ring and queues it to be fed, waiting for the
+ * workers to catch up if the ring is full. */
+static GstFlowReturn
+gst_deepspeech_batch_pad_feed (GstDeepSpeechBatch * batch,
+    GstDeepSpeechBatchPad * pad, const gint16 * samples, gsize n_samples,
+    GstClockTime timestamp)
+{
+  guint64 offset;
+  gsize written;
+
+  pad->segment_samples += n_samples;
+
+  g_mutex_lock (&batch->lock);
+  while (n_samples > 0) {
+    while (!pad->flushing && gst_deepspeech_ring_space (&pad->audio) == 0)
+      g_cond_wait (&batch->cond, &batch->lock);
+    if (pad->flushing) {
+      g_mutex_unlock (&batch->lock);
+      return GST_FLOW_FLUSHING;
+    }
+
+    offset = pad->audio.end;
+    written = gst_deepspeech_ring_append (&pad->audio, samples, n_samples);
+    gst_deepspeech_batch_pad_queue_job (batch, pad, GST_DEEPSPEECH_BATCH_JOB_FEED,
+        offset, written, timestamp, GST_CLOCK_TIME_NONE);
+    samples += written;
+    n_samples -= written;
+  }
+  g_mutex_unlock (&batch->lock);
+
+  return GST_FLOW_OK;
+}
+
+static void
+gst_deepspeech_batch_pad_end_segment (GstDeepSpeechBatch * batch,
+    GstDeepSpeechBatchPad * pad)
+{
+  g_mutex_lock (&batch->lock);
+  if (!pad->flushing)
+    gst_deepspeech_batch_pad_queue_job (batch, pad, GST_DEEPSPEECH_BATCH_JOB_END,
+        pad->audio.end, 0, pad->segment_pts, gst_util_uint64_scale_int (
+            pad->segment_samples, GST_SECOND, pad->rate));
+  g_mutex_unlock (&batch->lock);
+
+  pad->in_speech = FALSE;
+  pad->segment_samples = 0;
+  pad->quiet_samples = 0;
+  pad->segment_pts = GST_CLOCK_TIME_NONE;
+}
+
+/* Makes sure the pad's voice activity detector and rings match the current
+ * properties and caps. The sample ring is only resized while it is empty. */
+static void
+gst_deepspeech_batch_pad_prepare (GstDeepSpeechBatch * batch,
+    GstDeepSpeechBatchPad * pad)
+{
+  guint64 preroll_samples, capacity;
+
+  if (pad->vad == NULL || pad->vad->type != batch->vad_type ||
+      pad->vad->rate != pad->rate) {
+    if (pad->vad)
+      gst_deepspeech_vad_free (pad->vad);
+    pad->vad = gst_deepspeech_vad_new (batch->vad_type, pad->rate);
+  }
+  pad->vad->threshold = batch->silence_threshold;
+
+  preroll_samples = gst_util_uint64_scale_int (batch->pre_roll_duration,
+      pad->rate, GST_SECOND);
+  if (pad->preroll.capacity != preroll_samples)
+    gst_deepspeech_ring_init (&pad->preroll, preroll_samples);
+
+  capacity = gst_util_uint64_scale_int (PAD_RING_DURATION, pad->rate, GST_SECOND);
+  if (pad->audio.capacity != capacity) {
+    g_mutex_lock (&batch->lock);
+    if (pad->audio.length == 0)
+      gst_deepspeech_ring_init (&pad->audio, capacity);
+    g_mutex_unlock (&batch->lock);
+  }
+}
+
+static GstFlowReturn
+gst_deepspeech_batch_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstDeepSpeechBatch *batch = GST_DEEPSPEECH_BATCH (parent);
+  GstDeepSpeechBatchPad *bpad = GST_DEEPSPEECH_BATCH_PAD (pad);
+  GstMapInfo info;
+  const gint16 *samples, *first, *second;
+  gsize n_samples, first_len, second_len;
+  GstClockTime timestamp, preroll_duration;
+  gboolean speech;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if (bpad->convert == NULL) {
+    gst_buffer_unref (buf);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+  gst_deepspeech_batch_pad_prepare (batch, bpad);
+
+  if (!gst_buffer_map (buf, &info, GST_MAP_READ)) {
+    GST_WARNING_OBJECT (pad, "Could not map %" GST_PTR_FORMAT, buf);
+    gst_buffer_unref (buf);
+    return GST_FLOW_OK;
+  }
+  if (GST_BUFFER_IS_DISCONT (buf))
+    gst_deepspeech_convert_reset (bpad->convert);
+  n_samples = gst_deepspeech_convert_process (bpad->convert, info.data,
+      info.size, &samples);
+  timestamp = GST_BUFFER_TIMESTAMP (buf);
+
+  speech = gst_deepspeech_vad_is_speech (bpad->vad, samples, n_samples);
+  if (!speech && !bpad->in_speech) {
+    gst_deepspeech_ring_write (&bpad->preroll, samples, n_samples);
+    goto done;
+  }
+
+  if (!bpad->in_speech) {
+    preroll_duration = gst_util_uint64_scale_int (bpad->preroll.length,
+        GST_SECOND, bpad->rate);
+    if (GST_CLOCK_TIME_IS_VALID (timestamp))
+      bpad->segment_pts = timestamp > preroll_duration ?
+          timestamp - preroll_duration : 0;
+    bpad->in_speech = TRUE;
+
+    gst_deepspeech_ring_peek (&bpad->preroll, &first, &first_len,
+        &second, &second_len);
+    ret = gst_deepspeech_batch_pad_feed (batch, bpad, first, first_len,
+        bpad->segment_pts);
+    if (ret == GST_FLOW_OK)
+      ret = gst_deepspeech_batch_pad_feed (batch, bpad, second, second_len,
+          bpad->segment_pts);
+    gst_deepspeech_ring_clear (&bpad->preroll);
+  }
+
+  if (ret == GST_FLOW_OK)
+    ret = gst_deepspeech_batch_pad_feed (batch, bpad, samples, n_samples,
+        timestamp);
+  if (ret != GST_FLOW_OK)
+    goto done;
+
+  if (speech)
+    bpad->quiet_samples = 0;
+  else
+    bpad->quiet_samples += n_samples;
+
+  if (bpad->quiet_samples >= gst_util_uint64_scale_int (batch->silence_duration,
+          bpad->rate, GST_SECOND) ||
+      (batch->max_segment_duration > 0 &&
+          bpad->segment_samples >= gst_util_uint64_scale_int (
+              batch->max_segment_duration, bpad->rate, GST_SECOND)))
+    gst_deepspeech_batch_pad_end_segment (batch, bpad);
+
+done:
+  gst_buffer_unmap (buf, &info);
+  gst_buffer_unref (buf);
+  return ret;
+}
+
+static gboolean
+gst_deepspeech_batch_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstDeepSpeechBatch *batch = GST_DEEPSPEECH_BATCH (parent);
+  GstDeepSpeechBatchPad *bpad = GST_DEEPSPEECH_BATCH_PAD (pad);
+  gboolean last = FALSE;
+  gboolean ret = TRUE;
+
+  GST_LOG_OBJECT (pad, "Received %s event: %" GST_PTR_FORMAT,
+      GST_EVENT_TYPE_NAME (event), event);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:
+    {
+      GstDeepSpeechConvert *convert;
+      GstAudioInfo info;
+      GstCaps *caps;
+
+      /* the model is loaded by now, so its rate is known */
+      gst_event_parse_caps (event, &caps);
+      if (!gst_audio_info_from_caps (&info, caps) ||
+          (convert = gst_deepspeech_convert_new (&info, batch->rate,
+                  TRUE)) == NULL) {
+        GST_WARNING_OBJECT (pad, "Can't convert %" GST_PTR_FORMAT
+            " to %d Hz", caps, batch->rate);
+        ret = FALSE;
+        break;
+      }
+      if (bpad->convert)
+        gst_deepspeech_convert_free (bpad->convert);
+      bpad->convert = convert;
+      bpad->rate = batch->rate;
+      break;
+    }
+    case GST_EVENT_SEGMENT:
+      gst_event_copy_segment (event, &bpad->segment);
+      break;
+    case GST_EVENT_FLUSH_START:
+      g_mutex_lock (&batch->lock);
+      bpad->flushing = TRUE;
+      g_cond_broadcast (&batch->cond);
+      g_mutex_unlock (&batch->lock);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      g_mutex_lock (&batch->lock);
+      gst_deepspeech_batch_pad_clear (bpad);
+      bpad->flushing = FALSE;
+      if (bpad->finished)
+        batch->active_pads++;
+      bpad->eos = FALSE;
+      bpad->finished = FALSE;
+      /* the utterance that was cut short is never decoded */
+      gst_deepspeech_batch_pad_queue_job (batch, bpad,
+          GST_DEEPSPEECH_BATCH_JOB_DISCARD, bpad->audio.end, 0,
+          GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE);
+      g_mutex_unlock (&batch->lock);
+
+      bpad->in_speech = FALSE;
+      bpad->segment_samples = 0;
+      bpad->quiet_samples = 0;
+      gst_segment_init (&bpad->segment, GST_FORMAT_TIME);
+      gst_deepspeech_ring_clear (&bpad->preroll);
+      if (bpad->vad)
+        gst_deepspeech_vad_reset (bpad->vad);
+      if (bpad->convert)
+        gst_deepspeech_convert_reset (bpad->convert);
+      break;
+    case GST_EVENT_EOS:
+      if (bpad->in_speech)
+        gst_deepspeech_batch_pad_end_segment (batch, bpad);
+      gst_deepspeech_ring_clear (&bpad->preroll);
+      if (bpad->vad)
+        gst_deepspeech_vad_reset (bpad->vad);
+
+      g_mutex_lock (&batch->lock);
+      bpad->eos = TRUE;
+      last = gst_deepspeech_batch_pad_maybe_finish (batch, bpad);
+      g_mutex_unlock (&batch->lock);
+
+      if (last)
+        gst_deepspeech_batch_post_eos (batch);
+      break;
+    default:
+      break;
+  }
+
+  /* there is nothing downstream to forward events to */
+  gst_event_unref (event);
+  return ret;
+}
@@ -0,0 +1,145 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_DEEPSPEECH_BATCH_H__
+#define __GST_DEEPSPEECH_BATCH_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstqueuearray.h>
+#include "deepspeech.h"
+#include "gstdeepspeechconvert.h"
+#include "gstdeepspeechmodel.h"
+#include "gstdeepspeechring.h"
+#include "gstdeepspeechvad.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_DEEPSPEECH_BATCH \
+  (gst_deepspeech_batch_get_type())
+#define GST_DEEPSPEECH_BATCH(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_DEEPSPEECH_BATCH,GstDeepSpeechBatch))
+#define GST_DEEPSPEECH_BATCH_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_DEEPSPEECH_BATCH,GstDeepSpeechBatchClass))
+#define GST_IS_DEEPSPEECH_BATCH(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_DEEPSPEECH_BATCH))
+#define GST_IS_DEEPSPEECH_BATCH_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_DEEPSPEECH_BATCH))
+
+#define GST_TYPE_DEEPSPEECH_BATCH_PAD \
+  (gst_deepspeech_batch_pad_get_type())
+#define GST_DEEPSPEECH_BATCH_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_DEEPSPEECH_BATCH_PAD,GstDeepSpeechBatchPad))
+#define GST_IS_DEEPSPEECH_BATCH_PAD(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_DEEPSPEECH_BATCH_PAD))
+
+typedef struct _GstDeepSpeechBatch      GstDeepSpeechBatch;
+typedef struct _GstDeepSpeechBatchClass GstDeepSpeechBatchClass;
+typedef struct _GstDeepSpeechBatchPad      GstDeepSpeechBatchPad;
+typedef struct _GstDeepSpeechBatchPadClass GstDeepSpeechBatchPadClass;
+
+/* One input stream. The segmentation state belongs to the pad's streaming
+ * thread, everything from audio on is protected by the element's lock, and
+ * the DeepSpeech stream is only touched by whichever worker is running the
+ * pad (there is never more than one). */
+struct _GstDeepSpeechBatchPad
+{
+  GstPad           parent;
+  guint            stream_id;
+  gint             rate;
+  GstDeepSpeechConvert *convert;
+  GstSegment       segment;
+  GstDeepSpeechVad *vad;
+  GstDeepSpeechRing preroll;
+  gboolean         in_speech;
+  guint64          quiet_samples;
+  guint64          segment_samples;
+  GstClockTime     segment_pts;
+  GstDeepSpeechRing audio;
+  GstQueueArray    *pending;
+  gboolean         scheduled;
+  gboolean         busy;
+  guint64          busy_offset;
+  gboolean         eos;
+  gboolean         finished;
+  gboolean         flushing;
+  StreamingState   *stream;
+};
+
+struct _GstDeepSpeechBatchPadClass
+{
+  GstPadClass parent_class;
+};
+
+struct _GstDeepSpeechBatch
+{
+  GstElement       element;
+  GstDeepSpeechModel *model;
+  GThreadPool      *pool;
+  GMutex           lock;
+  GCond            cond;
+  gint             rate;
+  gboolean         stopping;
+  guint            next_stream_id;
+  guint            active_pads;
+  gchar            *speech_model_path;
+  gchar            *scorer_path;
+  gint             beam_width;
+  gdouble          silence_threshold;
+  GstClockTime     silence_duration;
+  GstClockTime     max_segment_duration;
+  GstDeepSpeechVadType vad_type;
+  GstClockTime     pre_roll_duration;
+  guint            workers;
+};
+
+struct _GstDeepSpeechBatchClass
+{
+  GstElementClass parent_class;
+};
+
+GType gst_deepspeech_batch_get_type (void);
+GType gst_deepspeech_batch_pad_get_type (void);
+
+G_END_DECLS
+
+#endif /* __GST_DEEPSPEECH_BATCH_H__ */
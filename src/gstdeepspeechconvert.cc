@@ -0,0 +1,192 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Input conversion for the deepspeech element.
+ *
+ * DeepSpeech wants mono signed 16 bit samples at the rate the model was
+ * trained on.  Rather than requiring audioconvert and audioresample in front
+ * of every element, with the extra buffers and copies that brings, any
+ * common raw format is accepted and converted here in one pass by
+ * GstAudioConverter, whose resampler has vectorized paths for the usual
+ * architectures.  Channels are averaged down to mono, unless the element
+ * transcribes each of them separately.
+ *
+ * The output goes to a scratch buffer rather than straight into a sample
+ * ring: until the voice activity detector has looked at it, it isn't known
+ * whether it belongs in the pre-roll or in the segment, a buffer may be
+ * split between two segments, and separately transcribed channels are
+ * deinterleaved into rings of their own, which GstAudioConverter 1.14 can't
+ * write.  The scratch buffer is reused, so the extra pass stays in cache.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "gstdeepspeechconvert.h"
+
+GST_DEBUG_CATEGORY_EXTERN (gst_deepspeech_debug);
+#define GST_CAT_DEFAULT gst_deepspeech_debug
+
+/* Every input channel contributes equally to the single output channel. */
+static void
+gst_deepspeech_convert_set_downmix (GstStructure * config, gint channels)
+{
+  GValue matrix = G_VALUE_INIT;
+  GValue row = G_VALUE_INIT;
+  GValue weight = G_VALUE_INIT;
+  gint i;
+
+  g_value_init (&matrix, GST_TYPE_ARRAY);
+  g_value_init (&row, GST_TYPE_ARRAY);
+  g_value_init (&weight, G_TYPE_FLOAT);
+  g_value_set_float (&weight, 1.0f / channels);
+  for (i = 0; i < channels; i++)
+    gst_value_array_append_value (&row, &weight);
+  gst_value_array_append_and_take_value (&matrix, &row);
+  gst_structure_take_value (config, GST_AUDIO_CONVERTER_OPT_MIX_MATRIX, &matrix);
+  g_value_unset (&weight);
+}
+
+/* Returns NULL if GstAudioConverter can't handle the input. */
+GstDeepSpeechConvert *
+gst_deepspeech_convert_new (const GstAudioInfo * in_info, gint out_rate,
+    gboolean downmix)
+{
+  GstDeepSpeechConvert *convert;
+  GstAudioInfo out_info;
+  GstStructure *config;
+  gint channels = GST_AUDIO_INFO_CHANNELS (in_info);
+
+  convert = g_new0 (GstDeepSpeechConvert, 1);
+  convert->in_info = *in_info;
+  convert->out_rate = out_rate;
+  convert->out_channels = downmix ? 1 : channels;
+
+  if (GST_AUDIO_INFO_FORMAT (in_info) == GST_AUDIO_FORMAT_S16 &&
+      convert->out_channels == channels && GST_AUDIO_INFO_RATE (in_info) == out_rate)
+    return convert;
+
+  GST_DEBUG ("Converting %s, %d channels at %d Hz to %d channel S16 at %d Hz",
+      GST_AUDIO_INFO_NAME (in_info), channels, GST_AUDIO_INFO_RATE (in_info),
+      convert->out_channels, out_rate);
+
+  /* the output keeps the input's channel positions, if any */
+  if (convert->out_channels == 1)
+    gst_audio_info_set_format (&out_info, GST_AUDIO_FORMAT_S16, out_rate, 1, NULL);
+  else
+    gst_audio_info_set_format (&out_info, GST_AUDIO_FORMAT_S16, out_rate,
+        channels, in_info->position);
+  /* dithering buys nothing for recognition */
+  config = gst_structure_new ("GstDeepSpeechConvert",
+      GST_AUDIO_CONVERTER_OPT_DITHER_METHOD, GST_TYPE_AUDIO_DITHER_METHOD,
+      GST_AUDIO_DITHER_NONE,
+      GST_AUDIO_CONVERTER_OPT_NOISE_SHAPING_METHOD,
+      GST_TYPE_AUDIO_NOISE_SHAPING_METHOD, GST_AUDIO_NOISE_SHAPING_NONE, NULL);
+  if (convert->out_channels == 1 && channels > 1)
+    gst_deepspeech_convert_set_downmix (config, channels);
+
+  convert->converter = gst_audio_converter_new (GST_AUDIO_CONVERTER_FLAG_NONE,
+      &convert->in_info, &out_info, config);
+  if (convert->converter == NULL) {
+    g_free (convert);
+    return NULL;
+  }
+  return convert;
+}
+
+void
+gst_deepspeech_convert_free (GstDeepSpeechConvert * convert)
+{
+  if (convert->converter)
+    gst_audio_converter_free (convert->converter);
+  g_free (convert->out);
+  g_free (convert);
+}
+
+/* Forgets the resampler history, after a discontinuity. */
+void
+gst_deepspeech_convert_reset (GstDeepSpeechConvert * convert)
+{
+  if (convert->converter)
+    gst_audio_converter_reset (convert->converter);
+}
+
+/* Converts size bytes of interleaved input and returns the number of
+ * frames produced. *samples points at them until the next call, and at
+ * data itself if no conversion is needed. */
+gsize
+gst_deepspeech_convert_process (GstDeepSpeechConvert * convert,
+    gconstpointer data, gsize size, const gint16 ** samples)
+{
+  gsize in_frames = size / GST_AUDIO_INFO_BPF (&convert->in_info);
+  gsize out_frames;
+  gpointer in[1], out[1];
+
+  if (convert->converter == NULL) {
+    *samples = (const gint16 *) data;
+    return in_frames;
+  }
+
+  *samples = convert->out;
+  if (in_frames == 0)
+    return 0;
+
+  out_frames = gst_audio_converter_get_out_frames (convert->converter, in_frames);
+  if (out_frames * convert->out_channels > convert->out_size) {
+    g_free (convert->out);
+    convert->out_size = out_frames * convert->out_channels;
+    convert->out = g_new (gint16, convert->out_size);
+    *samples = convert->out;
+  }
+
+  in[0] = (gpointer) data;
+  out[0] = convert->out;
+  if (!gst_audio_converter_samples (convert->converter,
+          GST_AUDIO_CONVERTER_FLAG_NONE, in, in_frames, out, out_frames)) {
+    GST_WARNING ("Could not convert %" G_GSIZE_FORMAT " frames", in_frames);
+    return 0;
+  }
+  return out_frames;
+}
@@ -0,0 +1,88 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_DEEPSPEECH_DEFAULTS_H__
+#define __GST_DEEPSPEECH_DEFAULTS_H__
+
+#include <gst/gst.h>
+#include "gstdeepspeechvad.h"
+
+G_BEGIN_DECLS
+
+/* Defaults and property descriptions shared by the deepspeech and
+ * deepspeechbatch elements, so the two stay in step. */
+
+#define DEFAULT_BEAM_WIDTH 500
+#define DEFAULT_SPEECH_MODEL "/usr/share/deepspeech/models/deepspeech-0.9.3-models.pbmm"
+#define DEFAULT_SCORER "/usr/share/deepspeech/models/deepspeech-0.9.3-models.scorer"
+#define DEFAULT_SILENCE_THRESHOLD 0.02
+#define DEFAULT_MAX_SEGMENT_DURATION (60 * GST_SECOND)
+#define DEFAULT_VAD GST_DEEPSPEECH_VAD_ENERGY
+#define DEFAULT_PRE_ROLL_DURATION (200 * GST_MSECOND)
+
+/* The audio is converted to what the model expects internally, so common
+ * raw formats are taken as they come */
+#define GST_DEEPSPEECH_AUDIO_CAPS \
+    "audio/x-raw, format=(string){ S16LE, S32LE, F32LE }, " \
+    "rate=(int)[ 8000, 192000 ], channels=(int)[ 1, 8 ], " \
+    "layout=(string)interleaved"
+
+#define GST_DEEPSPEECH_SPEECH_MODEL_BLURB \
+    "Location of the speech graph file."
+#define GST_DEEPSPEECH_BEAM_WIDTH_BLURB \
+    "The beam width used by the decoder. A larger beam width generates " \
+    "better results at the cost of decoding time."
+/* silence is how long the level has to stay below the threshold */
+#define GST_DEEPSPEECH_SILENCE_THRESHOLD_BLURB(silence) \
+    "Segment speech when the RMS level, relative to full scale, is below " \
+    "the threshold for " silence ". With vad=spectral-flux this is the " \
+    "minimum spectral flux of speech instead."
+#define GST_DEEPSPEECH_VAD_BLURB \
+    "How speech is told apart from silence."
+#define GST_DEEPSPEECH_PRE_ROLL_DURATION_BLURB \
+    "Amount of audio (in nanoseconds) from before the start of speech to " \
+    "include in a segment."
+
+G_END_DECLS
+
+#endif /* __GST_DEEPSPEECH_DEFAULTS_H__ */
@@ -0,0 +1,180 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Sum of squares of S16 samples, used by the silence detector on every
+ * incoming buffer.
+ *
+ * The vector kernels square pairs of samples with a multiply-add into 32 bit
+ * lanes and widen into 64 bit accumulators, so the result is exact for any
+ * buffer length.  Two squares of -32768 add up to exactly 2^31, which only
+ * fits an unsigned lane, so the 32 bit lanes are always zero-extended.  The
+ * best kernel for the running CPU is picked on first use.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "gstdeepspeechenergy.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define HAVE_X86_KERNELS 1
+#  include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define HAVE_NEON_KERNEL 1
+#  include <arm_neon.h>
+#endif
+
+typedef guint64 (*SumSquaresFunc) (const gint16 * samples, gsize n_samples);
+
+guint64
+gst_deepspeech_sum_squares_scalar (const gint16 * samples, gsize n_samples)
+{
+  guint64 sum = 0;
+  gsize i;
+
+  for (i = 0; i < n_samples; i++)
+    sum += (guint32) ((gint32) samples[i] * samples[i]);
+
+  return sum;
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__ ((target ("sse2")))
+static guint64
+sum_squares_sse2 (const gint16 * samples, gsize n_samples)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  __m128i acc = _mm_setzero_si128 ();
+  guint64 lanes[2];
+  gsize i;
+
+  for (i = 0; i + 8 <= n_samples; i += 8) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (samples + i));
+    __m128i sq = _mm_madd_epi16 (v, v);
+
+    acc = _mm_add_epi64 (acc, _mm_unpacklo_epi32 (sq, zero));
+    acc = _mm_add_epi64 (acc, _mm_unpackhi_epi32 (sq, zero));
+  }
+
+  _mm_storeu_si128 ((__m128i *) lanes, acc);
+  return lanes[0] + lanes[1] +
+      gst_deepspeech_sum_squares_scalar (samples + i, n_samples - i);
+}
+
+__attribute__ ((target ("avx2")))
+static guint64
+sum_squares_avx2 (const gint16 * samples, gsize n_samples)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  __m256i acc = _mm256_setzero_si256 ();
+  guint64 lanes[4];
+  gsize i;
+
+  for (i = 0; i + 16 <= n_samples; i += 16) {
+    __m256i v = _mm256_loadu_si256 ((const __m256i *) (samples + i));
+    __m256i sq = _mm256_madd_epi16 (v, v);
+
+    acc = _mm256_add_epi64 (acc, _mm256_unpacklo_epi32 (sq, zero));
+    acc = _mm256_add_epi64 (acc, _mm256_unpackhi_epi32 (sq, zero));
+  }
+
+  _mm256_storeu_si256 ((__m256i *) lanes, acc);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+      gst_deepspeech_sum_squares_scalar (samples + i, n_samples - i);
+}
+#endif
+
+#ifdef HAVE_NEON_KERNEL
+static guint64
+sum_squares_neon (const gint16 * samples, gsize n_samples)
+{
+  uint64x2_t acc = vdupq_n_u64 (0);
+  gsize i;
+
+  for (i = 0; i + 8 <= n_samples; i += 8) {
+    int16x8_t v = vld1q_s16 (samples + i);
+    int16x4_t lo = vget_low_s16 (v);
+    int16x4_t hi = vget_high_s16 (v);
+
+    /* each square fits a 32 bit lane on its own, as an unsigned value */
+    acc = vpadalq_u32 (acc, vreinterpretq_u32_s32 (vmull_s16 (lo, lo)));
+    acc = vpadalq_u32 (acc, vreinterpretq_u32_s32 (vmull_s16 (hi, hi)));
+  }
+
+  return vgetq_lane_u64 (acc, 0) + vgetq_lane_u64 (acc, 1) +
+      gst_deepspeech_sum_squares_scalar (samples + i, n_samples - i);
+}
+#endif
+
+static SumSquaresFunc
+select_sum_squares (void)
+{
+#ifdef HAVE_X86_KERNELS
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    return sum_squares_avx2;
+  if (__builtin_cpu_supports ("sse2"))
+    return sum_squares_sse2;
+#endif
+#ifdef HAVE_NEON_KERNEL
+  return sum_squares_neon;
+#endif
+  return gst_deepspeech_sum_squares_scalar;
+}
+
+guint64
+gst_deepspeech_sum_squares (const gint16 * samples, gsize n_samples)
+{
+  static gsize impl = 0;
+
+  if (g_once_init_enter (&impl))
+    g_once_init_leave (&impl, (gsize) select_sum_squares ());
+
+  return ((SumSquaresFunc) impl) (samples, n_samples);
+}
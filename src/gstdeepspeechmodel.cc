@@ -0,0 +1,662 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Process-wide registry of loaded DeepSpeech models.
+ *
+ * Loading a model maps the acoustic graph into memory, which costs several
+ * seconds and hundreds of megabytes.  Every deepspeech element asking for the
+ * same speech model and scorer shares a single ModelState from here and only
+ * creates its own StreamingState on top of it, with its own beam width and
+ * hot words.  A scorer is bound to its ModelState, so elements with
+ * different scorers load the model separately; the graph file's pages are
+ * still shared through the page cache.
+ * The model is freed once the last element releases it.
+ *
+ * The first utterance decoded with a fresh model is several times slower
+ * than the next ones, while TensorFlow initializes the graph and the model
+ * and scorer files are faulted in.  A warm-up decodes a second of silence
+ * ahead of time instead, and can also keep the files resident.  With
+ * GST_DEEPSPEECH_PRELOAD=model[:scorer] in the environment that happens
+ * in the background once the first element starts, and the model stays
+ * loaded until the process exits; GST_DEEPSPEECH_PRELOAD_LOCK=1 locks
+ * its files into memory as well.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <deepspeech.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>
+#endif
+
+#include "gstdeepspeechmodel.h"
+
+GST_DEBUG_CATEGORY_EXTERN (gst_deepspeech_debug);
+#define GST_CAT_DEFAULT gst_deepspeech_debug
+
+static GMutex registry_lock;
+static GCond registry_cond;
+static GHashTable *registry = NULL;
+
+/* The header of the trie that follows the language model in a scorer
+ * package, as DeepSpeech 0.9 writes it in native byte order: the magic
+ * 'TRIE', the file version, a UTF-8 mode flag and the default alpha and
+ * beta as doubles. */
+#define SCORER_TRIE_MAGIC 0x54524945
+#define SCORER_FILE_VERSION 6
+
+static void
+gst_deepspeech_model_free (GstDeepSpeechModel * model)
+{
+  if (model->model_state)
+    DS_FreeModel (model->model_state);
+  if (model->mapped_files)
+    g_ptr_array_unref (model->mapped_files);
+  g_mutex_clear (&model->inference_lock);
+  g_mutex_clear (&model->settings_lock);
+  g_free (model->key);
+  g_free (model->speech_model_path);
+  g_free (model->scorer_path);
+  g_free (model);
+}
+
+/* Makes scorer_path the enabled scorer, loading it unless it already is.
+ * Must be called with the settings lock held, or before the model is
+ * shared. */
+static gboolean
+gst_deepspeech_model_use_scorer (GstDeepSpeechModel * model,
+    const gchar * scorer_path)
+{
+  int status;
+
+  if (scorer_path && *scorer_path == '\0')
+    scorer_path = NULL;
+  if (g_strcmp0 (scorer_path, model->scorer_path) == 0)
+    return TRUE;
+
+  g_free (model->scorer_path);
+  model->scorer_path = NULL;
+  model->weights_known = FALSE;
+
+  if (scorer_path == NULL) {
+    GST_INFO ("Disabling scorer");
+    DS_DisableExternalScorer (model->model_state);
+    return TRUE;
+  }
+
+  GST_INFO ("Loading scorer %s", scorer_path);
+  status = DS_EnableExternalScorer (model->model_state, scorer_path);
+  if (status != 0) {
+    GST_ERROR ("Could not enable scorer %s (error %d)", scorer_path, status);
+    /* a failed load leaves the previous scorer disabled */
+    DS_DisableExternalScorer (model->model_state);
+    return FALSE;
+  }
+  model->scorer_path = g_strdup (scorer_path);
+  return TRUE;
+}
+
+static gchar *
+gst_deepspeech_model_key (const gchar * speech_model_path,
+    const gchar * scorer_path)
+{
+  return g_strconcat (speech_model_path, "\n", scorer_path, NULL);
+}
+
+static GstDeepSpeechModel *
+gst_deepspeech_model_new (const gchar * speech_model_path, gchar * key)
+{
+  GstDeepSpeechModel *model;
+
+  model = g_new0 (GstDeepSpeechModel, 1);
+  model->ref_count = 1;
+  model->key = key;
+  model->loading = TRUE;
+  model->speech_model_path = g_strdup (speech_model_path);
+  model->reentrant = !g_str_has_suffix (speech_model_path, ".tflite");
+  g_mutex_init (&model->inference_lock);
+  g_mutex_init (&model->settings_lock);
+
+  return model;
+}
+
+/* Loads the model and its scorer into a new entry of the registry. Runs
+ * without the registry locked, before anyone else can use the model. */
+static gboolean
+gst_deepspeech_model_load (GstDeepSpeechModel * model, const gchar * scorer_path)
+{
+  int status;
+
+  GST_INFO ("Loading speech model %s", model->speech_model_path);
+
+  status = DS_CreateModel (model->speech_model_path, &model->model_state);
+  if (status != 0) {
+    GST_ERROR ("Could not create model from %s (error %d)",
+        model->speech_model_path, status);
+    model->model_state = NULL;
+    return FALSE;
+  }
+
+  if (!gst_deepspeech_model_use_scorer (model, scorer_path)) {
+    DS_FreeModel (model->model_state);
+    model->model_state = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Drops a reference with the registry locked. Returns TRUE if it was the
+ * last one, and the model is to be freed once the registry is unlocked. */
+static gboolean
+gst_deepspeech_model_unref_locked (GstDeepSpeechModel * model)
+{
+  if (--model->ref_count > 0)
+    return FALSE;
+
+  /* a model that failed to load is already gone from the registry */
+  if (g_hash_table_lookup (registry, model->key) == model)
+    g_hash_table_remove (registry, model->key);
+  return TRUE;
+}
+
+/* Returns a reference to the model loaded from the given file with the
+ * given scorer (NULL or empty for none), loading both if no other element
+ * holds one yet.  Returns NULL if loading fails. */
+GstDeepSpeechModel *
+gst_deepspeech_model_acquire (const gchar * speech_model_path,
+    const gchar * scorer_path)
+{
+  GstDeepSpeechModel *model;
+  gboolean loaded, failed;
+  gchar *key;
+
+  g_return_val_if_fail (speech_model_path != NULL, NULL);
+
+  if (scorer_path == NULL)
+    scorer_path = "";
+  key = gst_deepspeech_model_key (speech_model_path, scorer_path);
+
+  /* The model is entered in the registry before it is loaded, so that two
+   * elements starting at once with the same configuration don't both load
+   * it; the second one waits for the first to finish. Loading happens with
+   * the registry unlocked, so models of other configurations can be
+   * acquired and released in the meantime. */
+  g_mutex_lock (&registry_lock);
+  if (registry == NULL)
+    registry = g_hash_table_new (g_str_hash, g_str_equal);
+
+  model = (GstDeepSpeechModel *) g_hash_table_lookup (registry, key);
+  if (model) {
+    g_free (key);
+    model->ref_count++;
+    while (model->loading)
+      g_cond_wait (&registry_cond, &registry_lock);
+    if (model->model_state == NULL) {
+      failed = gst_deepspeech_model_unref_locked (model);
+      g_mutex_unlock (&registry_lock);
+      if (failed)
+        gst_deepspeech_model_free (model);
+      return NULL;
+    }
+    GST_DEBUG ("Sharing loaded model %s (%d users)", model->key,
+        model->ref_count);
+    g_mutex_unlock (&registry_lock);
+    return model;
+  }
+
+  model = gst_deepspeech_model_new (speech_model_path, key);
+  g_hash_table_insert (registry, model->key, model);
+  g_mutex_unlock (&registry_lock);
+
+  loaded = gst_deepspeech_model_load (model, scorer_path);
+
+  g_mutex_lock (&registry_lock);
+  model->loading = FALSE;
+  failed = FALSE;
+  if (!loaded) {
+    /* elements still waiting for it drop their references themselves */
+    g_hash_table_remove (registry, model->key);
+    failed = gst_deepspeech_model_unref_locked (model);
+  }
+  g_cond_broadcast (&registry_cond);
+  g_mutex_unlock (&registry_lock);
+
+  if (loaded)
+    return model;
+  if (failed)
+    gst_deepspeech_model_free (model);
+  return NULL;
+}
+
+/* Drops a reference obtained from gst_deepspeech_model_acquire().  All
+ * streams created from the model must have been freed beforehand. */
+void
+gst_deepspeech_model_release (GstDeepSpeechModel * model)
+{
+  gboolean last;
+
+  g_return_if_fail (model != NULL);
+
+  g_mutex_lock (&registry_lock);
+  last = gst_deepspeech_model_unref_locked (model);
+  g_mutex_unlock (&registry_lock);
+
+  if (last) {
+    GST_INFO ("Freeing speech model %s", model->speech_model_path);
+    gst_deepspeech_model_free (model);
+  }
+}
+
+/* Creates a stream with the given settings.  Returns NULL if DeepSpeech
+ * fails to create the stream. */
+StreamingState *
+gst_deepspeech_model_create_stream (GstDeepSpeechModel * model,
+    const GstDeepSpeechStreamSettings * settings)
+{
+  StreamingState *stream = NULL;
+  GHashTableIter iter;
+  gpointer word, boost;
+  int status;
+
+  g_mutex_lock (&model->settings_lock);
+  DS_SetModelBeamWidth (model->model_state, settings->beam_width);
+  if (model->scorer_path) {
+    DS_ClearHotWords (model->model_state);
+    if (settings->hot_words) {
+      g_hash_table_iter_init (&iter, settings->hot_words);
+      while (g_hash_table_iter_next (&iter, &word, &boost)) {
+        status = DS_AddHotWord (model->model_state, (const char *) word,
+            *(gfloat *) boost);
+        if (status != 0)
+          GST_WARNING ("Could not add hot word %s (error %d)",
+              (const gchar *) word, status);
+      }
+    }
+  } else if (settings->hot_words && g_hash_table_size (settings->hot_words) > 0) {
+    GST_WARNING ("Hot words need a scorer, ignoring them");
+  }
+
+  status = DS_CreateStream (model->model_state, &stream);
+  g_mutex_unlock (&model->settings_lock);
+
+  if (status != 0) {
+    GST_WARNING ("DS_CreateStream returned %d", status);
+    return NULL;
+  }
+  return stream;
+}
+
+/* Switches the scorer of a model only the caller holds, in place, so that
+ * streams created from then on use it without reloading the acoustic model.
+ * If another element shares the model, or already has it loaded with that
+ * scorer, nothing changes and shared is set. If the new scorer fails to
+ * load, the previous one is loaded back. The scorer is loaded with only the
+ * model's settings lock held, so other elements can acquire and release
+ * models meanwhile. Returns whether the scorer is now scorer_path. */
+gboolean
+gst_deepspeech_model_switch_scorer (GstDeepSpeechModel * model,
+    const gchar * scorer_path, gboolean * shared)
+{
+  gchar *key, *previous;
+  gboolean ret;
+
+  if (scorer_path == NULL)
+    scorer_path = "";
+  *shared = FALSE;
+  if (g_strcmp0 (scorer_path, model->scorer_path ? model->scorer_path : "") == 0)
+    return TRUE;
+
+  key = gst_deepspeech_model_key (model->speech_model_path, scorer_path);
+  g_mutex_lock (&registry_lock);
+  if (model->ref_count > 1 || g_hash_table_contains (registry, key)) {
+    g_mutex_unlock (&registry_lock);
+    g_free (key);
+    *shared = TRUE;
+    return FALSE;
+  }
+  /* taken out of the registry while its scorer changes, so nobody starts
+   * sharing it meanwhile and the lock needn't be held during the load */
+  if (g_hash_table_lookup (registry, model->key) == model)
+    g_hash_table_remove (registry, model->key);
+  g_mutex_unlock (&registry_lock);
+  g_free (key);
+
+  g_mutex_lock (&model->settings_lock);
+  previous = g_strdup (model->scorer_path);
+  ret = gst_deepspeech_model_use_scorer (model, scorer_path);
+  if (!ret && !gst_deepspeech_model_use_scorer (model, previous))
+    GST_ERROR ("Could not load back scorer %s", previous);
+  key = gst_deepspeech_model_key (model->speech_model_path,
+      model->scorer_path ? model->scorer_path : "");
+  g_mutex_unlock (&model->settings_lock);
+  g_free (previous);
+
+  /* another element may have loaded the same configuration in the
+   * meantime; this model then stays private to its element */
+  g_mutex_lock (&registry_lock);
+  g_free (model->key);
+  model->key = key;
+  if (!g_hash_table_contains (registry, model->key))
+    g_hash_table_insert (registry, model->key, model);
+  g_mutex_unlock (&registry_lock);
+
+  return ret;
+}
+
+/* Sets the language model weight and word insertion bonus of the scorer.
+ * Unlike the beam width these are read by the scorer while decoding, so they
+ * take effect immediately, for every stream of every element sharing the
+ * model.  Returns FALSE if the model has no scorer. */
+gboolean
+gst_deepspeech_model_set_alpha_beta (GstDeepSpeechModel * model, gfloat alpha,
+    gfloat beta)
+{
+  int status;
+
+  g_mutex_lock (&model->settings_lock);
+  gst_deepspeech_model_lock (model);
+  status = DS_SetScorerAlphaBeta (model->model_state, alpha, beta);
+  gst_deepspeech_model_unlock (model);
+  if (status == 0) {
+    model->alpha = alpha;
+    model->beta = beta;
+    model->weights_known = TRUE;
+  }
+  g_mutex_unlock (&model->settings_lock);
+
+  if (status != 0) {
+    GST_WARNING ("Could not set scorer alpha=%f beta=%f (error %d)", alpha,
+        beta, status);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* Reads the weights a scorer package sets when it is enabled, which
+ * DeepSpeech has no call to return, from its trie header. The language
+ * model in front of it has no fixed size, so the header is searched for. */
+static gboolean
+gst_deepspeech_model_read_scorer_weights (const gchar * path, gfloat * alpha,
+    gfloat * beta)
+{
+  const gint32 header[2] = { SCORER_TRIE_MAGIC, SCORER_FILE_VERSION };
+  GMappedFile *file;
+  const gsize needed = sizeof (header) + 1 + 2 * sizeof (gdouble);
+  const gchar *data, *p, *end;
+  gdouble weights[2];
+  gboolean found = FALSE;
+  gsize length;
+
+  file = g_mapped_file_new (path, FALSE, NULL);
+  if (file == NULL)
+    return FALSE;
+
+  data = g_mapped_file_get_contents (file);
+  length = g_mapped_file_get_length (file);
+  if (data && length >= needed) {
+    end = data + length - needed + 1;
+    for (p = data; p < end; p++) {
+      p = (const gchar *) memchr (p, ((const gchar *) header)[0], end - p);
+      if (p == NULL)
+        break;
+      if (memcmp (p, header, sizeof (header)) == 0) {
+        memcpy (weights, p + sizeof (header) + 1, sizeof (weights));
+        found = TRUE;
+        break;
+      }
+    }
+  }
+  g_mapped_file_unref (file);
+
+  if (!found) {
+    GST_WARNING ("Could not find the weights in scorer %s", path);
+    return FALSE;
+  }
+  *alpha = (gfloat) weights[0];
+  *beta = (gfloat) weights[1];
+  return TRUE;
+}
+
+/* Returns the scorer's current weights: the last ones set, or the ones it
+ * came with. Returns FALSE if the model has no scorer or they can't be
+ * read. */
+gboolean
+gst_deepspeech_model_get_alpha_beta (GstDeepSpeechModel * model, gfloat * alpha,
+    gfloat * beta)
+{
+  gboolean ret;
+
+  g_mutex_lock (&model->settings_lock);
+  if (!model->weights_known && model->scorer_path)
+    model->weights_known = gst_deepspeech_model_read_scorer_weights (
+        model->scorer_path, &model->alpha, &model->beta);
+  ret = model->weights_known && model->scorer_path != NULL;
+  *alpha = model->alpha;
+  *beta = model->beta;
+  g_mutex_unlock (&model->settings_lock);
+
+  return ret;
+}
+
+/* Brackets any DS_FeedAudioContent() or decode call on a stream of this
+ * model.  It is a no-op for models that allow concurrent inference, so
+ * independent elements only contend on their own stream lock. */
+void
+gst_deepspeech_model_lock (GstDeepSpeechModel * model)
+{
+  if (!model->reentrant)
+    g_mutex_lock (&model->inference_lock);
+}
+
+void
+gst_deepspeech_model_unlock (GstDeepSpeechModel * model)
+{
+  if (!model->reentrant)
+    g_mutex_unlock (&model->inference_lock);
+}
+
+/* Maps the file and asks for all of it to be read in, so that DeepSpeech's
+ * own mapping of it doesn't fault pages in while decoding. With lock the
+ * pages are also kept from being evicted for as long as the model lives. */
+static void
+gst_deepspeech_model_map_file (GstDeepSpeechModel * model, const gchar * path,
+    gboolean lock)
+{
+  GMappedFile *file;
+  GError *error = NULL;
+  gchar *contents;
+  gsize length;
+
+  file = g_mapped_file_new (path, FALSE, &error);
+  if (file == NULL) {
+    GST_WARNING ("Could not map %s: %s", path, error->message);
+    g_error_free (error);
+    return;
+  }
+
+  contents = g_mapped_file_get_contents (file);
+  length = g_mapped_file_get_length (file);
+  if (contents == NULL || length == 0) {
+    g_mapped_file_unref (file);
+    return;
+  }
+
+#ifdef HAVE_MADVISE
+  if (madvise (contents, length, MADV_WILLNEED) != 0)
+    GST_DEBUG ("madvise on %s failed: %s", path, g_strerror (errno));
+#endif
+#ifdef HAVE_MLOCK
+  if (lock && mlock (contents, length) != 0)
+    GST_WARNING ("Could not lock %s into memory: %s", path, g_strerror (errno));
+#else
+  if (lock)
+    GST_WARNING ("Locking %s into memory is not supported", path);
+#endif
+
+  if (model->mapped_files == NULL)
+    model->mapped_files = g_ptr_array_new_with_free_func (
+        (GDestroyNotify) g_mapped_file_unref);
+  g_ptr_array_add (model->mapped_files, file);
+}
+
+/* Decodes a second of silence with stream, which this finishes, so that the
+ * first real utterance runs at steady-state speed, and reads the model and
+ * scorer files into memory. Only the first call for a model warms it up;
+ * later ones return FALSE and leave stream untouched. */
+gboolean
+gst_deepspeech_model_warm_up (GstDeepSpeechModel * model,
+    StreamingState * stream, gboolean lock_files)
+{
+  gint64 start = g_get_monotonic_time ();
+  gchar *scorer_path;
+  gint16 *silence;
+  guint n_samples;
+  char *text;
+
+  if (!g_atomic_int_compare_and_exchange (&model->warm, FALSE, TRUE))
+    return FALSE;
+
+  g_mutex_lock (&model->settings_lock);
+  scorer_path = g_strdup (model->scorer_path);
+  g_mutex_unlock (&model->settings_lock);
+
+  gst_deepspeech_model_map_file (model, model->speech_model_path, lock_files);
+  if (scorer_path)
+    gst_deepspeech_model_map_file (model, scorer_path, lock_files);
+
+  n_samples = DS_GetModelSampleRate (model->model_state);
+  silence = g_new0 (gint16, n_samples);
+  gst_deepspeech_model_lock (model);
+  DS_FeedAudioContent (stream, silence, n_samples);
+  text = DS_FinishStream (stream);
+  gst_deepspeech_model_unlock (model);
+  DS_FreeString (text);
+  g_free (silence);
+
+  GST_INFO ("Warmed up speech model %s in %" G_GINT64_FORMAT " ms",
+      model->speech_model_path, (g_get_monotonic_time () - start) / 1000);
+  g_free (scorer_path);
+
+  return TRUE;
+}
+
+/* The preloading thread, and the model it loaded, kept until the process
+ * exits so that the model outlives every element */
+static GThread *preload_thread = NULL;
+static GstDeepSpeechModel *preloaded_model = NULL;
+
+static gpointer
+gst_deepspeech_model_preload_thread (gpointer data)
+{
+  gchar **paths = (gchar **) data;
+  gboolean lock = g_strcmp0 (g_getenv ("GST_DEEPSPEECH_PRELOAD_LOCK"), "1") == 0;
+  GstDeepSpeechStreamSettings settings;
+  GstDeepSpeechModel *model;
+  StreamingState *stream;
+
+  model = gst_deepspeech_model_acquire (paths[0], paths[1]);
+  if (model == NULL) {
+    GST_WARNING ("Could not preload speech model %s", paths[0]);
+    g_strfreev (paths);
+    return NULL;
+  }
+  preloaded_model = model;
+
+  settings.beam_width = DS_GetModelBeamWidth (model->model_state);
+  settings.hot_words = NULL;
+  stream = gst_deepspeech_model_create_stream (model, &settings);
+  if (stream && !gst_deepspeech_model_warm_up (model, stream, lock))
+    DS_FreeStream (stream);
+  g_strfreev (paths);
+
+  return NULL;
+}
+
+/* Waits for a preload still in progress and drops its model. */
+static void
+gst_deepspeech_model_preload_release (void)
+{
+  g_thread_join (preload_thread);
+  preload_thread = NULL;
+  if (preloaded_model) {
+    gst_deepspeech_model_release (preloaded_model);
+    preloaded_model = NULL;
+  }
+}
+
+/* Starts loading and warming up the model named by GST_DEEPSPEECH_PRELOAD,
+ * if set, the first time an element starts, so that merely loading the
+ * plugin, as gst-plugin-scanner and gst-inspect-1.0 do, loads nothing. The
+ * model is loaded in the background and kept until the process exits; an
+ * element asking for it in the meantime waits for the load in the registry
+ * instead of loading it a second time. */
+void
+gst_deepspeech_model_preload_from_env (void)
+{
+  static gsize started = 0;
+  const gchar *preload;
+  gchar **paths;
+
+  if (!g_once_init_enter (&started))
+    return;
+
+  preload = g_getenv ("GST_DEEPSPEECH_PRELOAD");
+  if (preload && *preload != '\0' &&
+      g_strcmp0 (g_get_prgname (), "gst-plugin-scanner") != 0) {
+    paths = g_strsplit (preload, G_SEARCHPATH_SEPARATOR_S, 2);
+    GST_INFO ("Preloading speech model %s", paths[0]);
+    preload_thread = g_thread_new ("deepspeech-preload",
+        gst_deepspeech_model_preload_thread, paths);
+    atexit (gst_deepspeech_model_preload_release);
+  }
+  g_once_init_leave (&started, 1);
+}
@@ -0,0 +1,122 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_DEEPSPEECH_MODEL_H__
+#define __GST_DEEPSPEECH_MODEL_H__
+
+#include <gst/gst.h>
+#include "deepspeech.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstDeepSpeechModel GstDeepSpeechModel;
+
+/* A loaded acoustic model with its scorer, shared by every element in the
+ * process that asked for the same model file and the same scorer (or none).
+ * Elements with different scorers get models of their own, so switching
+ * scorers never stalls another element, and the scorer's weights are
+ * shared only by elements with the same scorer. Only the registry in
+ * gstdeepspeechmodel.cc touches ref_count, key and loading; while loading
+ * is set the model is being loaded without the registry locked, and others
+ * asking for it wait for the load to finish.
+ *
+ * The beam width and hot words are model settings that DeepSpeech latches
+ * into each stream when it is created, so streams of one model can use
+ * different ones; settings_lock keeps applying them and creating the stream
+ * together. scorer_path is the scorer enabled, which only changes while a
+ * single element uses the model. alpha and beta are its current weights,
+ * once weights_known.
+ *
+ * Streams created from a TensorFlow graph can run inference concurrently,
+ * but TFLite models share a single interpreter between all their streams,
+ * so for those inference_lock serializes every call into the model.
+ *
+ * warm is set once a warm-up has started, so that only the first element
+ * asking for one pays for it; mapped_files keeps the model files resident
+ * from then on. */
+struct _GstDeepSpeechModel
+{
+  gint             ref_count;
+  gchar            *key;
+  gboolean         loading;
+  gchar            *speech_model_path;
+  gchar            *scorer_path;
+  ModelState       *model_state;
+  gboolean         reentrant;
+  GMutex           inference_lock;
+  GMutex           settings_lock;
+  gint             warm;
+  GPtrArray        *mapped_files;
+  gboolean         weights_known;
+  gfloat           alpha;
+  gfloat           beta;
+};
+
+/* What a stream is created with. hot_words maps each word to a pointer to
+ * its gfloat boost and may be NULL. */
+typedef struct
+{
+  gint             beam_width;
+  GHashTable       *hot_words;
+} GstDeepSpeechStreamSettings;
+
+GstDeepSpeechModel * gst_deepspeech_model_acquire (const gchar * speech_model_path,
+    const gchar * scorer_path);
+gboolean gst_deepspeech_model_switch_scorer (GstDeepSpeechModel * model,
+    const gchar * scorer_path, gboolean * shared);
+void gst_deepspeech_model_release (GstDeepSpeechModel * model);
+StreamingState * gst_deepspeech_model_create_stream (GstDeepSpeechModel * model,
+    const GstDeepSpeechStreamSettings * settings);
+gboolean gst_deepspeech_model_set_alpha_beta (GstDeepSpeechModel * model,
+    gfloat alpha, gfloat beta);
+gboolean gst_deepspeech_model_get_alpha_beta (GstDeepSpeechModel * model,
+    gfloat * alpha, gfloat * beta);
+void gst_deepspeech_model_lock (GstDeepSpeechModel * model);
+void gst_deepspeech_model_unlock (GstDeepSpeechModel * model);
+gboolean gst_deepspeech_model_warm_up (GstDeepSpeechModel * model,
+    StreamingState * stream, gboolean lock_files);
+void gst_deepspeech_model_preload_from_env (void);
+
+G_END_DECLS
+
+#endif /* __GST_DEEPSPEECH_MODEL_H__ */
@@ -0,0 +1,182 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstdeepspeechring.h"
+
+/* (Re)allocates the ring for the given capacity, discarding its contents. */
+void
+gst_deepspeech_ring_init (GstDeepSpeechRing * ring, gsize capacity)
+{
+  if (ring->data == NULL || ring->capacity != capacity) {
+    g_free (ring->data);
+    ring->data = capacity > 0 ? g_new (gint16, capacity) : NULL;
+    ring->capacity = capacity;
+  }
+  gst_deepspeech_ring_clear (ring);
+}
+
+void
+gst_deepspeech_ring_free (GstDeepSpeechRing * ring)
+{
+  g_free (ring->data);
+  ring->data = NULL;
+  ring->capacity = 0;
+  gst_deepspeech_ring_clear (ring);
+}
+
+void
+gst_deepspeech_ring_clear (GstDeepSpeechRing * ring)
+{
+  ring->start = 0;
+  ring->length = 0;
+  ring->end = 0;
+}
+
+void
+gst_deepspeech_ring_write (GstDeepSpeechRing * ring, const gint16 * samples,
+    gsize n_samples)
+{
+  gsize end, chunk;
+
+  if (ring->capacity == 0)
+    return;
+
+  /* only the most recent capacity samples can survive */
+  if (n_samples >= ring->capacity) {
+    memcpy (ring->data, samples + n_samples - ring->capacity,
+        ring->capacity * sizeof (gint16));
+    ring->start = 0;
+    ring->length = ring->capacity;
+    ring->end += n_samples;
+    return;
+  }
+
+  end = (ring->start + ring->length) % ring->capacity;
+  chunk = MIN (n_samples, ring->capacity - end);
+  memcpy (ring->data + end, samples, chunk * sizeof (gint16));
+  memcpy (ring->data, samples + chunk, (n_samples - chunk) * sizeof (gint16));
+
+  ring->length += n_samples;
+  ring->end += n_samples;
+  if (ring->length > ring->capacity) {
+    ring->start = (ring->start + ring->length - ring->capacity) % ring->capacity;
+    ring->length = ring->capacity;
+  }
+}
+
+/* Returns the stored samples, oldest first, as up to two contiguous spans
+ * without copying them. Returns the total number of samples. */
+gsize
+gst_deepspeech_ring_peek (GstDeepSpeechRing * ring,
+    const gint16 ** first, gsize * first_len,
+    const gint16 ** second, gsize * second_len)
+{
+  *first = ring->data + ring->start;
+  *first_len = MIN (ring->length, ring->capacity - ring->start);
+  *second = ring->data;
+  *second_len = ring->length - *first_len;
+
+  return ring->length;
+}
+
+gsize
+gst_deepspeech_ring_space (GstDeepSpeechRing * ring)
+{
+  return ring->capacity - ring->length;
+}
+
+/* Appends as many samples as there is space for, never overwriting any.
+ * Returns the number of samples appended. */
+gsize
+gst_deepspeech_ring_append (GstDeepSpeechRing * ring, const gint16 * samples,
+    gsize n_samples)
+{
+  n_samples = MIN (n_samples, gst_deepspeech_ring_space (ring));
+  if (n_samples > 0)
+    gst_deepspeech_ring_write (ring, samples, n_samples);
+  return n_samples;
+}
+
+/* Like gst_deepspeech_ring_peek(), for the n_samples stored from position
+ * offset on. The range must not have been released. */
+void
+gst_deepspeech_ring_peek_range (GstDeepSpeechRing * ring, guint64 offset,
+    gsize n_samples, const gint16 ** first, gsize * first_len,
+    const gint16 ** second, gsize * second_len)
+{
+  gsize index;
+
+  *first_len = *second_len = 0;
+  g_return_if_fail (offset >= ring->end - ring->length);
+  g_return_if_fail (offset + n_samples <= ring->end);
+
+  index = ring->start + (gsize) (offset - (ring->end - ring->length));
+  if (index >= ring->capacity)
+    index -= ring->capacity;
+
+  *first = ring->data + index;
+  *first_len = MIN (n_samples, ring->capacity - index);
+  *second = ring->data;
+  *second_len = n_samples - *first_len;
+}
+
+/* Frees the space of every sample before position offset. */
+void
+gst_deepspeech_ring_release (GstDeepSpeechRing * ring, guint64 offset)
+{
+  guint64 oldest = ring->end - ring->length;
+  gsize n_samples;
+
+  if (offset <= oldest || ring->length == 0)
+    return;
+
+  n_samples = (gsize) (MIN (offset, ring->end) - oldest);
+  ring->start = (ring->start + n_samples) % ring->capacity;
+  ring->length -= n_samples;
+}
@@ -0,0 +1,86 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_DEEPSPEECH_RING_H__
+#define __GST_DEEPSPEECH_RING_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstDeepSpeechRing GstDeepSpeechRing;
+
+/* Fixed-capacity ring of S16 samples. Writing more than fits overwrites the
+ * oldest samples. Alternatively it can be used as a queue: samples are
+ * appended only while there is space, addressed by their position since the
+ * ring was cleared, and released once they have been consumed. */
+struct _GstDeepSpeechRing
+{
+  gint16           *data;
+  gsize            capacity;
+  gsize            start;
+  gsize            length;
+  guint64          end;
+};
+
+void gst_deepspeech_ring_init (GstDeepSpeechRing * ring, gsize capacity);
+void gst_deepspeech_ring_free (GstDeepSpeechRing * ring);
+void gst_deepspeech_ring_clear (GstDeepSpeechRing * ring);
+void gst_deepspeech_ring_write (GstDeepSpeechRing * ring,
+    const gint16 * samples, gsize n_samples);
+gsize gst_deepspeech_ring_peek (GstDeepSpeechRing * ring,
+    const gint16 ** first, gsize * first_len,
+    const gint16 ** second, gsize * second_len);
+
+gsize gst_deepspeech_ring_space (GstDeepSpeechRing * ring);
+gsize gst_deepspeech_ring_append (GstDeepSpeechRing * ring,
+    const gint16 * samples, gsize n_samples);
+void gst_deepspeech_ring_peek_range (GstDeepSpeechRing * ring,
+    guint64 offset, gsize n_samples,
+    const gint16 ** first, gsize * first_len,
+    const gint16 ** second, gsize * second_len);
+void gst_deepspeech_ring_release (GstDeepSpeechRing * ring, guint64 offset);
+
+G_END_DECLS
+
+#endif /* __GST_DEEPSPEECH_RING_H__ */
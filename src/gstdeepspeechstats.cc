@@ -0,0 +1,123 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstdeepspeechstats.h"
+
+/* Upper bounds of all but the last latency bucket */
+static const GstClockTime latency_bounds[GST_DEEPSPEECH_STATS_BUCKETS - 1] = {
+  10 * GST_MSECOND, 25 * GST_MSECOND, 50 * GST_MSECOND, 100 * GST_MSECOND,
+  250 * GST_MSECOND, 500 * GST_MSECOND, GST_SECOND, 2500 * GST_MSECOND,
+  5 * GST_SECOND
+};
+
+void
+gst_deepspeech_stats_reset (GstDeepSpeechStats * stats)
+{
+  memset (stats, 0, sizeof (*stats));
+}
+
+void
+gst_deepspeech_stats_add_latency (guint64 * histogram, GstClockTime latency)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (latency_bounds); i++) {
+    if (latency <= latency_bounds[i])
+      break;
+  }
+  histogram[i]++;
+}
+
+static void
+gst_deepspeech_stats_take_array (GstStructure * s, const gchar * field,
+    const guint64 * values, guint n_values)
+{
+  GValue array = G_VALUE_INIT;
+  GValue v = G_VALUE_INIT;
+  guint i;
+
+  g_value_init (&array, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_UINT64);
+  for (i = 0; i < n_values; i++) {
+    g_value_set_uint64 (&v, values[i]);
+    gst_value_array_append_value (&array, &v);
+  }
+  g_value_unset (&v);
+  gst_structure_take_value (s, field, &array);
+}
+
+/* The real-time factor is processing time over audio duration, so above 1
+ * a single stream can't keep up. Histograms are arrays of counts, with the
+ * bounds of their buckets in nanoseconds in latency-bounds. */
+GstStructure *
+gst_deepspeech_stats_to_structure (const GstDeepSpeechStats * stats,
+    const gchar * name)
+{
+  GstStructure *s;
+  gdouble rtf;
+
+  rtf = stats->fed_duration == 0 ? 0.0 :
+      (gdouble) stats->processing_time / stats->fed_duration;
+  s = gst_structure_new (name,
+      "real-time-factor", G_TYPE_DOUBLE, rtf,
+      "fed-duration", G_TYPE_UINT64, stats->fed_duration,
+      "decoded-duration", G_TYPE_UINT64, stats->decoded_duration,
+      "processing-time", G_TYPE_UINT64, stats->processing_time,
+      "lock-wait-time", G_TYPE_UINT64, stats->lock_wait_time,
+      "decoded-segments", G_TYPE_UINT64, stats->decoded_segments,
+      "bytes-copied", G_TYPE_UINT64, stats->bytes_copied, NULL);
+  gst_deepspeech_stats_take_array (s, "latency-bounds", latency_bounds,
+      G_N_ELEMENTS (latency_bounds));
+  gst_deepspeech_stats_take_array (s, "feed-latency", stats->feed_latency,
+      GST_DEEPSPEECH_STATS_BUCKETS);
+  gst_deepspeech_stats_take_array (s, "decode-latency", stats->decode_latency,
+      GST_DEEPSPEECH_STATS_BUCKETS);
+
+  return s;
+}
@@ -0,0 +1,85 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_DEEPSPEECH_STATS_H__
+#define __GST_DEEPSPEECH_STATS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Number of latency histogram buckets. Bucket i counts latencies of up to
+ * the i-th bound given by gst_deepspeech_stats_to_structure, the last one
+ * everything longer. */
+#define GST_DEEPSPEECH_STATS_BUCKETS 10
+
+typedef struct _GstDeepSpeechStats GstDeepSpeechStats;
+
+/* Running totals of where decoding time goes, kept by the element under
+ * its stats lock.
+ *
+ * fed_duration is the audio fed to the model and processing_time the time
+ * spent feeding and decoding it, not counting lock_wait_time spent
+ * waiting for a model shared with other streams. feed_latency counts, per
+ * decoded segment, the time spent feeding its audio and decode_latency the
+ * time from the segment's end being queued until its result was ready. */
+struct _GstDeepSpeechStats
+{
+  GstClockTime     fed_duration;
+  GstClockTime     decoded_duration;
+  GstClockTime     processing_time;
+  GstClockTime     lock_wait_time;
+  guint64          decoded_segments;
+  guint64          bytes_copied;
+  guint64          feed_latency[GST_DEEPSPEECH_STATS_BUCKETS];
+  guint64          decode_latency[GST_DEEPSPEECH_STATS_BUCKETS];
+};
+
+void gst_deepspeech_stats_reset (GstDeepSpeechStats * stats);
+void gst_deepspeech_stats_add_latency (guint64 * histogram, GstClockTime latency);
+GstStructure * gst_deepspeech_stats_to_structure (const GstDeepSpeechStats * stats,
+    const gchar * name);
+
+G_END_DECLS
+
+#endif /* __GST_DEEPSPEECH_STATS_H__ */
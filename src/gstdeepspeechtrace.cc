@@ -0,0 +1,119 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+/* GstTracerRecord is not part of the stable API in 1.14 */
+#define GST_USE_UNSTABLE_API
+#include "gstdeepspeechtrace.h"
+
+#if !defined (GST_DISABLE_GST_DEBUG) && !defined (GST_DEEPSPEECH_DISABLE_TRACE)
+
+GstDebugCategory *gst_deepspeech_tracer_category = NULL;
+
+static GstTracerRecord *trace_record;
+
+static const gchar *trace_points[] = {
+  "vad",
+  "handoff",
+  "feed",
+  "intermediate-decode",
+  "finish"
+};
+
+static GstStructure *
+gst_deepspeech_trace_field (GType type, const gchar * description)
+{
+  return gst_structure_new ("value",
+      "type", G_TYPE_GTYPE, type,
+      "description", G_TYPE_STRING, description, NULL);
+}
+
+/* Registers the record, once, from the plugin's init function. */
+void
+gst_deepspeech_trace_init (void)
+{
+  if (trace_record)
+    return;
+
+  trace_record = gst_tracer_record_new ("deepspeech.class",
+      "element", GST_TYPE_STRUCTURE, gst_structure_new ("scope",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "related-to", GST_TYPE_TRACER_VALUE_SCOPE,
+          GST_TRACER_VALUE_SCOPE_ELEMENT, NULL),
+      "channel", GST_TYPE_STRUCTURE, gst_deepspeech_trace_field (G_TYPE_UINT,
+          "input channel, 0 unless split-channels is set"),
+      "point", GST_TYPE_STRUCTURE, gst_deepspeech_trace_field (G_TYPE_STRING,
+          "vad, handoff, feed, intermediate-decode or finish"),
+      "ts", GST_TYPE_STRUCTURE, gst_deepspeech_trace_field (G_TYPE_UINT64,
+          "start of the span"),
+      "duration", GST_TYPE_STRUCTURE, gst_deepspeech_trace_field (G_TYPE_UINT64,
+          "time spent in the span"),
+      "samples", GST_TYPE_STRUCTURE, gst_deepspeech_trace_field (G_TYPE_UINT64,
+          "samples processed, or handed off to the worker"),
+      NULL);
+  /* outlives every element, like the records of the tracers themselves */
+  GST_OBJECT_FLAG_SET (trace_record, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+
+  GST_DEBUG_CATEGORY_GET (gst_deepspeech_tracer_category, "GST_TRACER");
+}
+
+void
+gst_deepspeech_trace_log (GstDeepSpeechTracePoint point, GstObject * element,
+    guint channel, GstClockTime start, guint64 n_samples)
+{
+  GstClockTime end = gst_util_get_timestamp ();
+  gchar *name;
+
+  if (trace_record == NULL)
+    return;
+
+  name = gst_object_get_name (element);
+  gst_tracer_record_log (trace_record, name, channel, trace_points[point],
+      start, end - start, n_samples);
+  g_free (name);
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_DEEPSPEECH_TRACE_H__
+#define __GST_DEEPSPEECH_TRACE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Points on the hot path that are logged as "deepspeech" GstTracer
+ * records, next to those of the tracers enabled with GST_TRACERS, so that
+ * a stall can be lined up with what the rest of the pipeline was doing.
+ * Each record has the element, channel, point, start time (as the tracers
+ * take it, from gst_util_get_timestamp), duration and number of samples.
+ *
+ * Records are only logged while GST_TRACER is at TRACE level, as with
+ * GST_DEBUG="GST_TRACER:7". Otherwise a trace point costs a comparison or
+ * two and takes no timestamps; if the plugin is configured with
+ * --disable-tracepoints, or GStreamer without debugging, it costs nothing. */
+typedef enum
+{
+  GST_DEEPSPEECH_TRACE_VAD,
+  GST_DEEPSPEECH_TRACE_HANDOFF,
+  GST_DEEPSPEECH_TRACE_FEED,
+  GST_DEEPSPEECH_TRACE_INTERMEDIATE_DECODE,
+  GST_DEEPSPEECH_TRACE_FINISH
+} GstDeepSpeechTracePoint;
+
+#if !defined (GST_DISABLE_GST_DEBUG) && !defined (GST_DEEPSPEECH_DISABLE_TRACE)
+
+void gst_deepspeech_trace_init (void);
+void gst_deepspeech_trace_log (GstDeepSpeechTracePoint point, GstObject * element,
+    guint channel, GstClockTime start, guint64 n_samples);
+
+/* the category GstTracerRecord logs to, NULL until the plugin is loaded */
+extern GstDebugCategory *gst_deepspeech_tracer_category;
+
+#define GST_DEEPSPEECH_TRACING() G_UNLIKELY (GST_LEVEL_TRACE <= _gst_debug_min && \
+    gst_deepspeech_tracer_category != NULL && \
+    gst_debug_category_get_threshold (gst_deepspeech_tracer_category) >= \
+        GST_LEVEL_TRACE)
+
+/* Start time of a span, or GST_CLOCK_TIME_NONE when nothing is logged */
+#define GST_DEEPSPEECH_TRACE_START() \
+    (GST_DEEPSPEECH_TRACING () ? gst_util_get_timestamp () : GST_CLOCK_TIME_NONE)
+
+/* Logs the span that began at start, which came from
+ * GST_DEEPSPEECH_TRACE_START */
+#define GST_DEEPSPEECH_TRACE(point, element, channel, start, n_samples) G_STMT_START { \
+  if (GST_CLOCK_TIME_IS_VALID (start)) \
+    gst_deepspeech_trace_log ((point), GST_OBJECT_CAST (element), (channel), \
+        (start), (n_samples)); \
+} G_STMT_END
+
+#else
+
+#define gst_deepspeech_trace_init() G_STMT_START { } G_STMT_END
+#define GST_DEEPSPEECH_TRACE_START() GST_CLOCK_TIME_NONE
+#define GST_DEEPSPEECH_TRACE(point, element, channel, start, n_samples) \
+    G_STMT_START { (void) (start); } G_STMT_END
+
+#endif
+
+G_END_DECLS
+
+#endif /* __GST_DEEPSPEECH_TRACE_H__ */
@@ -0,0 +1,319 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Voice activity detectors used to segment the incoming audio.
+ *
+ * energy:        the RMS level of the buffer relative to full scale is
+ *                compared against silence-threshold, so the decision does
+ *                not depend on the buffer size.
+ * spectral-flux: frames of ~32ms are transformed and speech is detected
+ *                when the 300-3400Hz band rises clearly above an adaptive
+ *                noise floor while its spectrum keeps changing (spectral
+ *                flux above silence-threshold).  Steady background noise
+ *                raises the floor instead of holding segments open.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <gst/gst.h>
+#include <gst/fft/gstfftf32.h>
+#include <math.h>
+#include <string.h>
+
+#include "gstdeepspeechvad.h"
+#include "gstdeepspeechenergy.h"
+
+/* energy */
+
+static gboolean
+energy_vad_is_speech (GstDeepSpeechVad * vad, const gint16 * samples,
+    gsize n_samples)
+{
+  gdouble level;
+
+  if (n_samples == 0)
+    return FALSE;
+
+  level = sqrt ((gdouble) vad->sum_squares /
+      ((gdouble) n_samples * 32768.0 * 32768.0));
+
+  return level >= vad->threshold;
+}
+
+static const GstDeepSpeechVadClass energy_vad_class = {
+  sizeof (GstDeepSpeechVad),
+  NULL,
+  NULL,
+  NULL,
+  energy_vad_is_speech
+};
+
+/* spectral-flux */
+
+#define SPECTRAL_FRAME_MS 32
+#define SPECTRAL_BAND_LOW 300
+#define SPECTRAL_BAND_HIGH 3400
+/* band energy needed above the noise floor (~6dB) */
+#define SPECTRAL_SNR 4.0
+/* noise floor adaptation per frame while not in speech, and while in it */
+#define SPECTRAL_FLOOR_RISE 0.05
+#define SPECTRAL_FLOOR_CREEP 0.002
+/* lowest noise floor, about -70dBFS */
+#define SPECTRAL_FLOOR_MIN 1e-7
+/* smoothing of the flux over consecutive frames */
+#define SPECTRAL_FLUX_SMOOTHING 0.5
+
+typedef struct
+{
+  GstDeepSpeechVad parent;
+
+  GstFFTF32        *fft;
+  gint             frame_len;
+  gint             frame_fill;
+  gfloat           *frame;
+  gfloat           *work;
+  GstFFTF32Complex *spectrum;
+  gfloat           *magnitude;
+  gfloat           *prev_magnitude;
+  gint             band_low;
+  gint             band_high;
+  gdouble          noise_floor;
+  gdouble          flux;
+  gboolean         speech;
+} SpectralFluxVad;
+
+static void
+spectral_vad_reset (GstDeepSpeechVad * vad)
+{
+  SpectralFluxVad *self = (SpectralFluxVad *) vad;
+
+  self->frame_fill = 0;
+  self->noise_floor = -1.0;
+  self->flux = 0.0;
+  self->speech = FALSE;
+  memset (self->prev_magnitude, 0,
+      sizeof (gfloat) * (self->frame_len / 2 + 1));
+}
+
+static void
+spectral_vad_init (GstDeepSpeechVad * vad)
+{
+  SpectralFluxVad *self = (SpectralFluxVad *) vad;
+  gint n_bins;
+
+  self->frame_len = gst_fft_next_fast_length (vad->rate * SPECTRAL_FRAME_MS / 1000);
+  n_bins = self->frame_len / 2 + 1;
+
+  self->fft = gst_fft_f32_new (self->frame_len, FALSE);
+  self->frame = g_new0 (gfloat, self->frame_len);
+  self->work = g_new0 (gfloat, self->frame_len);
+  self->spectrum = g_new0 (GstFFTF32Complex, n_bins);
+  self->magnitude = g_new0 (gfloat, n_bins);
+  self->prev_magnitude = g_new0 (gfloat, n_bins);
+  self->band_low = MAX (1, SPECTRAL_BAND_LOW * self->frame_len / vad->rate);
+  self->band_high = MIN (n_bins - 1, SPECTRAL_BAND_HIGH * self->frame_len / vad->rate);
+
+  spectral_vad_reset (vad);
+}
+
+static void
+spectral_vad_finalize (GstDeepSpeechVad * vad)
+{
+  SpectralFluxVad *self = (SpectralFluxVad *) vad;
+
+  gst_fft_f32_free (self->fft);
+  g_free (self->frame);
+  g_free (self->work);
+  g_free (self->spectrum);
+  g_free (self->magnitude);
+  g_free (self->prev_magnitude);
+}
+
+static gboolean
+spectral_vad_process_frame (SpectralFluxVad * self)
+{
+  gdouble energy = 0.0, rise = 0.0, total = 0.0, flux;
+  gfloat *swap;
+  gint i;
+
+  memcpy (self->work, self->frame, sizeof (gfloat) * self->frame_len);
+  gst_fft_f32_window (self->fft, self->work, GST_FFT_WINDOW_HAMMING);
+  gst_fft_f32_fft (self->fft, self->work, self->spectrum);
+
+  for (i = self->band_low; i <= self->band_high; i++) {
+    gfloat re = self->spectrum[i].r / self->frame_len;
+    gfloat im = self->spectrum[i].i / self->frame_len;
+    gfloat mag = sqrtf (re * re + im * im);
+
+    self->magnitude[i] = mag;
+    energy += mag * mag;
+    total += mag;
+    if (mag > self->prev_magnitude[i])
+      rise += mag - self->prev_magnitude[i];
+  }
+
+  swap = self->prev_magnitude;
+  self->prev_magnitude = self->magnitude;
+  self->magnitude = swap;
+
+  flux = total > 0.0 ? rise / total : 0.0;
+  self->flux = SPECTRAL_FLUX_SMOOTHING * self->flux +
+      (1.0 - SPECTRAL_FLUX_SMOOTHING) * flux;
+
+  if (self->noise_floor < 0.0)
+    self->noise_floor = MAX (energy, SPECTRAL_FLOOR_MIN);
+
+  self->speech = energy > self->noise_floor * SPECTRAL_SNR &&
+      self->flux >= self->parent.threshold;
+
+  /* fall quickly, rise slowly, and barely move during speech */
+  if (energy < self->noise_floor)
+    self->noise_floor = energy;
+  else
+    self->noise_floor += (energy - self->noise_floor) *
+        (self->speech ? SPECTRAL_FLOOR_CREEP : SPECTRAL_FLOOR_RISE);
+  self->noise_floor = MAX (self->noise_floor, SPECTRAL_FLOOR_MIN);
+
+  return self->speech;
+}
+
+/* A buffer holds speech if any frame completed within it does. Buffers too
+ * short to complete a frame keep the previous decision. */
+static gboolean
+spectral_vad_is_speech (GstDeepSpeechVad * vad, const gint16 * samples,
+    gsize n_samples)
+{
+  SpectralFluxVad *self = (SpectralFluxVad *) vad;
+  gboolean completed = FALSE, speech = FALSE;
+  gsize i;
+
+  for (i = 0; i < n_samples; i++) {
+    self->frame[self->frame_fill++] = samples[i] / 32768.0f;
+    if (self->frame_fill == self->frame_len) {
+      speech |= spectral_vad_process_frame (self);
+      completed = TRUE;
+      self->frame_fill = 0;
+    }
+  }
+
+  return completed ? speech : self->speech;
+}
+
+static const GstDeepSpeechVadClass spectral_vad_class = {
+  sizeof (SpectralFluxVad),
+  spectral_vad_init,
+  spectral_vad_finalize,
+  spectral_vad_reset,
+  spectral_vad_is_speech
+};
+
+GType
+gst_deepspeech_vad_type_get_type (void)
+{
+  static GType vad_type = 0;
+  static const GEnumValue vad_values[] = {
+    {GST_DEEPSPEECH_VAD_ENERGY, "Buffer RMS level below silence-threshold is silence", "energy"},
+    {GST_DEEPSPEECH_VAD_SPECTRAL_FLUX, "Speech band energy above an adaptive noise floor with spectral flux above silence-threshold", "spectral-flux"},
+    {0, NULL, NULL}
+  };
+
+  if (!vad_type) {
+    vad_type = g_enum_register_static ("GstDeepSpeechVadType", vad_values);
+  }
+  return vad_type;
+}
+
+GstDeepSpeechVad *
+gst_deepspeech_vad_new (GstDeepSpeechVadType type, gint rate)
+{
+  const GstDeepSpeechVadClass *klass;
+  GstDeepSpeechVad *vad;
+
+  switch (type) {
+    case GST_DEEPSPEECH_VAD_SPECTRAL_FLUX:
+      klass = &spectral_vad_class;
+      break;
+    case GST_DEEPSPEECH_VAD_ENERGY:
+    default:
+      klass = &energy_vad_class;
+      break;
+  }
+
+  vad = (GstDeepSpeechVad *) g_malloc0 (klass->instance_size);
+  vad->klass = klass;
+  vad->type = type;
+  vad->rate = rate;
+  if (klass->init)
+    klass->init (vad);
+
+  return vad;
+}
+
+void
+gst_deepspeech_vad_free (GstDeepSpeechVad * vad)
+{
+  if (vad->klass->finalize)
+    vad->klass->finalize (vad);
+  g_free (vad);
+}
+
+/* Forgets any state carried over from earlier audio */
+void
+gst_deepspeech_vad_reset (GstDeepSpeechVad * vad)
+{
+  if (vad->klass->reset)
+    vad->klass->reset (vad);
+}
+
+/* The buffer energy is always computed, both for the backends and for the
+ * element's speech gate. */
+gboolean
+gst_deepspeech_vad_is_speech (GstDeepSpeechVad * vad, const gint16 * samples,
+    gsize n_samples)
+{
+  vad->sum_squares = gst_deepspeech_sum_squares (samples, n_samples);
+  return vad->klass->is_speech (vad, samples, n_samples);
+}
@@ -0,0 +1,95 @@
+/*
+ * GStreamer DeepSpeech plugin
+ * Copyright (C) 2017 Mike Sheldon <elleo@gnu.org>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_DEEPSPEECH_VAD_H__
+#define __GST_DEEPSPEECH_VAD_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_DEEPSPEECH_VAD_ENERGY,
+  GST_DEEPSPEECH_VAD_SPECTRAL_FLUX
+} GstDeepSpeechVadType;
+
+#define GST_TYPE_DEEPSPEECH_VAD_TYPE (gst_deepspeech_vad_type_get_type ())
+GType gst_deepspeech_vad_type_get_type (void);
+
+typedef struct _GstDeepSpeechVad GstDeepSpeechVad;
+typedef struct _GstDeepSpeechVadClass GstDeepSpeechVadClass;
+
+/* A voice activity detector decides for each incoming buffer whether it
+ * contains speech. Backends embed GstDeepSpeechVad as their first member
+ * and provide a GstDeepSpeechVadClass. */
+struct _GstDeepSpeechVad
+{
+  const GstDeepSpeechVadClass *klass;
+  GstDeepSpeechVadType type;
+  gint             rate;
+  /* backend specific sensitivity, taken from silence-threshold */
+  gdouble          threshold;
+  /* sum of squares of the samples last passed to is_speech */
+  guint64          sum_squares;
+};
+
+struct _GstDeepSpeechVadClass
+{
+  gsize            instance_size;
+  void             (*init) (GstDeepSpeechVad * vad);
+  void             (*finalize) (GstDeepSpeechVad * vad);
+  void             (*reset) (GstDeepSpeechVad * vad);
+  gboolean         (*is_speech) (GstDeepSpeechVad * vad,
+                                 const gint16 * samples, gsize n_samples);
+};
+
+GstDeepSpeechVad * gst_deepspeech_vad_new (GstDeepSpeechVadType type, gint rate);
+void gst_deepspeech_vad_free (GstDeepSpeechVad * vad);
+void gst_deepspeech_vad_reset (GstDeepSpeechVad * vad);
+gboolean gst_deepspeech_vad_is_speech (GstDeepSpeechVad * vad,
+    const gint16 * samples, gsize n_samples);
+
+G_END_DECLS
+
+#endif /* __GST_DEEPSPEECH_VAD_H__ */